@@ -0,0 +1,359 @@
+#include "ArchiveSink.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <windows.h>
+
+
+// CRC-32 as used by zip (reflected, polynomial 0xEDB88320)
+static uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    static const std::vector<uint32_t> table = []() {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static std::string toUtf8(const std::wstring& text) {
+    if (text.empty()) return std::string();
+    int size = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), NULL, 0, NULL, NULL);
+    std::string result(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), &result[0], size, NULL, NULL);
+    return result;
+}
+
+// Little-endian fields of zip records
+static void put16(std::string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>(value >> 8);
+}
+static void put32(std::string& out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value & 0xFFFF));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+static void put64(std::string& out, uint64_t value) {
+    put32(out, static_cast<uint32_t>(value & 0xFFFFFFFF));
+    put32(out, static_cast<uint32_t>(value >> 32));
+}
+
+// Octal tar field, zero padded and NUL terminated
+static void putOctal(char* field, size_t width, uint64_t value) {
+    for (size_t i = width - 1; i-- > 0; value >>= 3) field[i] = static_cast<char>('0' + (value & 7));
+    field[width - 1] = '\0';
+}
+
+
+ArchiveSink::Member::Member(ArchiveSink& sink, const fs::path& path, uint64_t size)
+    : sink(sink), lock(sink.memberMutex) {
+    sink.beginMember(path, size);
+}
+
+ArchiveSink::Member::~Member() {
+    sink.endMember();
+}
+
+bool ArchiveSink::Member::write(const uint8_t* data, size_t length) {
+    return sink.writeMember(data, length);
+}
+
+bool ArchiveSink::Member::writeAt(uint64_t offset, const uint8_t* data, size_t length) {
+    if (offset > sink.memberWritten && !sink.writeZeros(offset - sink.memberWritten)) return false;
+
+    uint64_t overlap = sink.memberWritten - (std::min)(offset, sink.memberWritten);
+    if (overlap >= length) return true;
+    return sink.writeMember(data + overlap, length - static_cast<size_t>(overlap));
+}
+
+
+ArchiveSink::ArchiveSink(const fs::path& archivePath, OutputSinkType type, const fs::path& baseFolder)
+    : streamBuffer(STREAM_BUFFER_SIZE), type(type), baseFolder(baseFolder) {
+    // Set before opening, one large buffer keeps the writes to the destination sequential and few
+    stream.rdbuf()->pubsetbuf(streamBuffer.data(), static_cast<std::streamsize>(streamBuffer.size()));
+    stream.open(archivePath, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Failed to create archive");
+    }
+
+    std::time_t now = std::time(nullptr);
+    unixTime = static_cast<uint64_t>(now);
+    std::tm local = *std::localtime(&now);
+    dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    dosDate = static_cast<uint16_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+}
+
+ArchiveSink::~ArchiveSink() {
+    close();
+}
+
+std::wstring ArchiveSink::getMemberName(const fs::path& path, const fs::path& baseFolder) {
+    fs::path relative = path.lexically_relative(baseFolder);
+    if (relative.empty() || *relative.begin() == L"..") relative = path.filename();
+    return relative.generic_wstring();
+}
+
+bool ArchiveSink::writeRaw(const void* data, size_t length) {
+    stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(length));
+    archiveOffset += length;
+    return static_cast<bool>(stream);
+}
+
+void ArchiveSink::writeTarHeader(const std::string& name, uint64_t size, char typeFlag) {
+    char header[TAR_BLOCK_SIZE] = {};
+    std::memcpy(header, name.data(), (std::min)(name.size(), static_cast<size_t>(100)));
+    putOctal(header + 100, 8, 0644);              // mode
+    putOctal(header + 108, 8, 0);                 // uid
+    putOctal(header + 116, 8, 0);                 // gid
+    putOctal(header + 124, 12, (std::min)(size, TAR_MAX_SIZE));
+    putOctal(header + 136, 12, unixTime);         // mtime
+    header[156] = typeFlag;
+    std::memcpy(header + 257, "ustar", 6);        // magic, NUL terminated
+    std::memcpy(header + 263, "00", 2);           // version
+
+    // Checksum is taken with its own field filled with spaces
+    std::memset(header + 148, ' ', 8);
+    uint32_t checksum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) checksum += static_cast<uint8_t>(header[i]);
+    putOctal(header + 148, 7, checksum);
+    writeRaw(header, TAR_BLOCK_SIZE);
+}
+
+void ArchiveSink::writeZipLocalHeader() {
+    std::string header;
+    put32(header, 0x04034B50);
+    put16(header, isZip64Member ? 45 : 20);        // version needed
+    put16(header, 0x0808);                         // sizes and CRC follow the data, UTF-8 name
+    put16(header, 0);                              // stored
+    put16(header, dosTime);
+    put16(header, dosDate);
+    put32(header, 0);                              // CRC, in the data descriptor
+    put32(header, isZip64Member ? 0xFFFFFFFF : 0);
+    put32(header, isZip64Member ? 0xFFFFFFFF : 0);
+    put16(header, static_cast<uint16_t>(memberName.size()));
+    put16(header, isZip64Member ? 20 : 0);
+    header += memberName;
+    if (isZip64Member) {
+        put16(header, 0x0001);
+        put16(header, 16);
+        put64(header, 0);
+        put64(header, 0);
+    }
+    writeRaw(header.data(), header.size());
+}
+
+void ArchiveSink::writeZipDataDescriptor() {
+    std::string descriptor;
+    put32(descriptor, 0x08074B50);
+    put32(descriptor, memberCrc);
+    if (isZip64Member) {
+        put64(descriptor, memberSize);
+        put64(descriptor, memberSize);
+    }
+    else {
+        put32(descriptor, static_cast<uint32_t>(memberSize));
+        put32(descriptor, static_cast<uint32_t>(memberSize));
+    }
+    writeRaw(descriptor.data(), descriptor.size());
+}
+
+void ArchiveSink::beginMember(const fs::path& path, uint64_t size) {
+    memberName = toUtf8(getMemberName(path, baseFolder));
+    memberSize = size;
+    memberWritten = 0;
+    memberCrc = 0;
+    memberOffset = archiveOffset;
+
+    if (type == OutputSinkType::TAR_TYPE) {
+        // ustar holds names up to 100 bytes and sizes below 8 GiB, anything else goes in a pax header
+        bool isAscii = std::all_of(memberName.begin(), memberName.end(), [](char c) { return static_cast<uint8_t>(c) < 0x80; });
+        if (memberName.size() > 100 || !isAscii || size > TAR_MAX_SIZE) {
+            std::string records;
+            auto addRecord = [&records](const std::string& key, const std::string& value) {
+                // The length prefix counts its own digits
+                size_t length = key.size() + value.size() + 3;
+                size_t total = length + std::to_string(length).size();
+                if (std::to_string(total).size() != std::to_string(length).size()) total++;
+                records += std::to_string(total) + " " + key + "=" + value + "\n";
+            };
+            addRecord("path", memberName);
+            if (size > TAR_MAX_SIZE) addRecord("size", std::to_string(size));
+
+            writeTarHeader("PaxHeader", records.size(), 'x');
+            writeRaw(records.data(), records.size());
+            writePadding((TAR_BLOCK_SIZE - records.size() % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+        }
+        writeTarHeader(memberName, size, '0');
+    }
+    else {
+        isZip64Member = size >= ZIP32_LIMIT || archiveOffset >= ZIP32_LIMIT;
+        writeZipLocalHeader();
+    }
+}
+
+bool ArchiveSink::writeMember(const uint8_t* data, size_t length) {
+    // The header already announced the size, extra data is dropped
+    length = static_cast<size_t>((std::min)(static_cast<uint64_t>(length), memberSize - memberWritten));
+    if (length == 0) return true;
+
+    if (type == OutputSinkType::ZIP_TYPE) memberCrc = updateCrc32(memberCrc, data, length);
+    memberWritten += length;
+    return writeRaw(data, length);
+}
+
+bool ArchiveSink::writeZeros(uint64_t length) {
+    static const std::vector<uint8_t> zeros(64 * 1024, 0);
+    while (length > 0) {
+        size_t chunk = static_cast<size_t>((std::min)(length, static_cast<uint64_t>(zeros.size())));
+        if (!writeMember(zeros.data(), chunk)) return false;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool ArchiveSink::writePadding(size_t length) {
+    static const char zeros[2 * TAR_BLOCK_SIZE] = {};
+    return writeRaw(zeros, length);
+}
+
+void ArchiveSink::endMember() {
+    writeZeros(memberSize - memberWritten);
+
+    if (type == OutputSinkType::TAR_TYPE) {
+        writePadding(static_cast<size_t>((TAR_BLOCK_SIZE - memberSize % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE));
+    }
+    else {
+        writeZipDataDescriptor();
+        zipEntries.push_back({ memberName, memberCrc, memberSize, memberOffset });
+    }
+}
+
+void ArchiveSink::writeZipCentralDirectory() {
+    uint64_t directoryOffset = archiveOffset;
+    for (const ZipEntry& entry : zipEntries) {
+        bool isLargeSize = entry.size >= ZIP32_LIMIT;
+        bool isLargeOffset = entry.headerOffset >= ZIP32_LIMIT;
+
+        std::string extra;
+        if (isLargeSize || isLargeOffset) {
+            put16(extra, 0x0001);
+            put16(extra, static_cast<uint16_t>((isLargeSize ? 16 : 0) + (isLargeOffset ? 8 : 0)));
+            if (isLargeSize) {
+                put64(extra, entry.size);
+                put64(extra, entry.size);
+            }
+            if (isLargeOffset) put64(extra, entry.headerOffset);
+        }
+
+        std::string record;
+        put32(record, 0x02014B50);
+        put16(record, 45);                         // version made by, MS-DOS
+        put16(record, extra.empty() ? 20 : 45);
+        put16(record, 0x0808);
+        put16(record, 0);
+        put16(record, dosTime);
+        put16(record, dosDate);
+        put32(record, entry.crc);
+        put32(record, isLargeSize ? 0xFFFFFFFF : static_cast<uint32_t>(entry.size));
+        put32(record, isLargeSize ? 0xFFFFFFFF : static_cast<uint32_t>(entry.size));
+        put16(record, static_cast<uint16_t>(entry.name.size()));
+        put16(record, static_cast<uint16_t>(extra.size()));
+        put16(record, 0);                          // comment
+        put16(record, 0);                          // disk
+        put16(record, 0);                          // internal attributes
+        put32(record, 0);                          // external attributes
+        put32(record, isLargeOffset ? 0xFFFFFFFF : static_cast<uint32_t>(entry.headerOffset));
+        record += entry.name;
+        record += extra;
+        writeRaw(record.data(), record.size());
+    }
+    uint64_t directorySize = archiveOffset - directoryOffset;
+    uint64_t entryCount = zipEntries.size();
+
+    std::string end;
+    if (entryCount >= 0xFFFF || directoryOffset >= ZIP32_LIMIT || directorySize >= ZIP32_LIMIT) {
+        uint64_t zip64EndOffset = archiveOffset;
+        put32(end, 0x06064B50);
+        put64(end, 44);                            // size of the rest of this record
+        put16(end, 45);
+        put16(end, 45);
+        put32(end, 0);
+        put32(end, 0);
+        put64(end, entryCount);
+        put64(end, entryCount);
+        put64(end, directorySize);
+        put64(end, directoryOffset);
+
+        put32(end, 0x07064B50);                    // locator
+        put32(end, 0);
+        put64(end, zip64EndOffset);
+        put32(end, 1);
+    }
+    put32(end, 0x06054B50);
+    put16(end, 0);
+    put16(end, 0);
+    put16(end, static_cast<uint16_t>((std::min)(entryCount, static_cast<uint64_t>(0xFFFF))));
+    put16(end, static_cast<uint16_t>((std::min)(entryCount, static_cast<uint64_t>(0xFFFF))));
+    put32(end, static_cast<uint32_t>((std::min)(directorySize, ZIP32_LIMIT)));
+    put32(end, static_cast<uint32_t>((std::min)(directoryOffset, ZIP32_LIMIT)));
+    put16(end, 0);                                 // comment
+    writeRaw(end.data(), end.size());
+}
+
+void ArchiveSink::close() {
+    if (isClosed) return;
+    finish();
+
+    std::lock_guard<std::mutex> lock(memberMutex);
+    if (type == OutputSinkType::TAR_TYPE) writePadding(2 * TAR_BLOCK_SIZE); // end of archive
+    else writeZipCentralDirectory();
+    stream.close();
+    isClosed = true;
+}
+
+void ArchiveSink::addFile(uint32_t target, const fs::path& path, uint64_t fileSize) {
+    pendingFiles[target] = { path, fileSize };
+}
+
+void ArchiveSink::startTarget(uint32_t target) {
+    current.reset();
+    while (!pendingFiles.empty() && pendingFiles.begin()->first <= target) {
+        auto next = pendingFiles.begin();
+        PendingFile file = std::move(next->second);
+        uint32_t nextTarget = next->first;
+        pendingFiles.erase(next);
+
+        if (nextTarget == target) {
+            current = std::make_unique<Member>(*this, file.path, file.fileSize);
+            currentTarget = target;
+        }
+        else {
+            // Nothing of this file could be read, it is stored as zeros like a plain file would be
+            Member empty(*this, file.path, file.fileSize);
+        }
+    }
+}
+
+bool ArchiveSink::write(uint32_t target, uint64_t offset, const uint8_t* data, size_t length) {
+    if (!current || target != currentTarget) {
+        startTarget(target);
+        if (!current) return false;
+    }
+    return current->writeAt(offset, data, length);
+}
+
+void ArchiveSink::finish() {
+    current.reset();
+    while (!pendingFiles.empty()) {
+        auto next = pendingFiles.begin();
+        Member empty(*this, next->second.path, next->second.fileSize);
+        pendingFiles.erase(next);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "OutputSink.h"
+#include "Enums.h"
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Writes all recovered files into one tar or uncompressed zip archive, front to back with no
+// seeking, so the target can also be a named pipe (\\.\pipe\name). Zip members carry their CRC in
+// a data descriptor and the central directory at the end is the index. Long or non-ASCII tar names
+// and members of 8 GiB or more use pax headers, large zip members and archives use Zip64
+class ArchiveSink : public OutputSink {
+public:
+    // One member being written. Holds the archive for its lifetime, so files written by parallel
+    // recovery jobs don't interleave. Data past what was written is padded with zeros at the end
+    class Member {
+    private:
+        ArchiveSink& sink;
+        std::unique_lock<std::mutex> lock;
+    public:
+        Member(ArchiveSink& sink, const fs::path& path, uint64_t size);
+        ~Member();
+        Member(const Member&) = delete;
+        Member& operator=(const Member&) = delete;
+
+        bool write(const uint8_t* data, size_t length);
+        // Write zeros up to offset, pieces that overlap what is already written are cut
+        bool writeAt(uint64_t offset, const uint8_t* data, size_t length);
+        uint64_t getWritten() const { return sink.memberWritten; }
+    };
+
+    ArchiveSink(const fs::path& archivePath, OutputSinkType type, const fs::path& baseFolder);
+    ~ArchiveSink() override;
+
+    ArchiveSink(const ArchiveSink&) = delete;
+    ArchiveSink& operator=(const ArchiveSink&) = delete;
+
+    // OutputSink: members of a sweep are written in target order
+    void addFile(uint32_t target, const fs::path& path, uint64_t fileSize) override;
+    bool write(uint32_t target, uint64_t offset, const uint8_t* data, size_t length) override;
+    void finish() override;
+    bool isSequential() const override { return true; }
+
+    // Name of path inside the archive, relative to the output folder and with '/' separators
+    static std::wstring getMemberName(const fs::path& path, const fs::path& baseFolder);
+    // Write the tar end blocks or the zip central directory, called by the destructor
+    void close();
+
+private:
+    static constexpr size_t TAR_BLOCK_SIZE = 512;
+    static constexpr uint64_t TAR_MAX_SIZE = 077777777777ULL; // 11 octal digits
+    static constexpr uint64_t ZIP32_LIMIT = 0xFFFFFFFFULL;
+    static constexpr size_t STREAM_BUFFER_SIZE = 1024 * 1024;
+
+    // Central directory record of a finished zip member
+    struct ZipEntry {
+        std::string name;
+        uint32_t crc;
+        uint64_t size;
+        uint64_t headerOffset;
+    };
+    struct PendingFile {
+        fs::path path;
+        uint64_t fileSize;
+    };
+
+    std::ofstream stream;
+    std::vector<char> streamBuffer;
+    OutputSinkType type;
+    fs::path baseFolder;
+    uint64_t archiveOffset = 0; // tellp doesn't work on pipes
+    uint16_t dosTime = 0;
+    uint16_t dosDate = 0;
+    uint64_t unixTime = 0;
+    bool isClosed = false;
+    std::mutex memberMutex;
+
+    // Member in progress
+    std::string memberName;
+    uint64_t memberSize = 0;
+    uint64_t memberWritten = 0;
+    uint32_t memberCrc = 0;
+    uint64_t memberOffset = 0;
+    bool isZip64Member = false;
+    std::vector<ZipEntry> zipEntries;
+
+    // Sweep state
+    std::map<uint32_t, PendingFile> pendingFiles; // registered and not started yet, in target order
+    std::unique_ptr<Member> current;
+    uint32_t currentTarget = 0;
+
+    void beginMember(const fs::path& path, uint64_t size);
+    bool writeMember(const uint8_t* data, size_t length);
+    bool writeZeros(uint64_t length);
+    // Zeros between tar records, not part of any member
+    bool writePadding(size_t length);
+    void endMember();
+    bool writeRaw(const void* data, size_t length);
+
+    void writeTarHeader(const std::string& name, uint64_t size, char typeFlag);
+    void writeZipLocalHeader();
+    void writeZipDataDescriptor();
+    void writeZipCentralDirectory();
+    // Start the member of target, after writing the untouched ones that come before it
+    void startTarget(uint32_t target);
+};
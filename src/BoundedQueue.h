@@ -0,0 +1,58 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Blocking queue with a fixed capacity. Producers wait while it is full, so a fast scanner can't
+// run arbitrarily far ahead of the recovery stage. close() ends the stream: consumers drain what
+// is left, later pushes are dropped
+template <typename T>
+class BoundedQueue {
+private:
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    size_t capacity;
+    bool isClosed = false;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Blocks while the queue is full, returns false if it was closed
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return isClosed || items.size() < capacity; });
+        if (isClosed) return false;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Waits for at least one item, then takes up to maxItems without waiting again.
+    // Returns false once the queue is closed and drained
+    bool popBatch(std::vector<T>& batch, size_t maxItems) {
+        batch.clear();
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return isClosed || !items.empty(); });
+        while (!items.empty() && batch.size() < maxItems) {
+            batch.push_back(std::move(items.front()));
+            items.pop_front();
+        }
+        notFull.notify_all();
+        return !batch.empty();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        isClosed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
@@ -0,0 +1,90 @@
+#include "ClusterBitset.h"
+#include <algorithm>
+#include <bitset>
+
+
+ClusterBitset::ClusterBitset(uint64_t clusterCount)
+    : chunkSlots(static_cast<size_t>((clusterCount + CLUSTERS_PER_CHUNK - 1) >> CHUNK_SHIFT), NO_CHUNK)
+    , chunkEpochs(chunkSlots.size(), 0) {
+}
+
+void ClusterBitset::clear() {
+    // Once the counter wraps old stamps would look current again, so clear for real
+    if (++epoch == 0) {
+        std::fill(pool.begin(), pool.end(), 0);
+        std::fill(chunkEpochs.begin(), chunkEpochs.end(), 0);
+        epoch = 1;
+    }
+}
+
+uint64_t* ClusterBitset::getChunk(uint64_t cluster) {
+    size_t chunk = static_cast<size_t>(cluster >> CHUNK_SHIFT);
+    if (chunk >= chunkSlots.size()) {
+        chunkSlots.resize(chunk + 1, NO_CHUNK);
+        chunkEpochs.resize(chunk + 1, 0);
+    }
+
+    if (chunkSlots[chunk] == NO_CHUNK) {
+        chunkSlots[chunk] = static_cast<uint32_t>(pool.size());
+        pool.resize(pool.size() + WORDS_PER_CHUNK, 0);
+        chunkEpochs[chunk] = epoch;
+    }
+
+    uint64_t* words = pool.data() + chunkSlots[chunk];
+    if (chunkEpochs[chunk] != epoch) {
+        std::fill(words, words + WORDS_PER_CHUNK, 0);
+        chunkEpochs[chunk] = epoch;
+    }
+    return words;
+}
+
+bool ClusterBitset::insert(uint64_t cluster) {
+    uint64_t* words = getChunk(cluster);
+    size_t bit = static_cast<size_t>(cluster & (CLUSTERS_PER_CHUNK - 1));
+    uint64_t mask = 1ULL << (bit & 63);
+
+    bool isNew = (words[bit >> 6] & mask) == 0;
+    words[bit >> 6] |= mask;
+    return isNew;
+}
+
+bool ClusterBitset::contains(uint64_t cluster) const {
+    size_t chunk = static_cast<size_t>(cluster >> CHUNK_SHIFT);
+    if (chunk >= chunkSlots.size() || chunkSlots[chunk] == NO_CHUNK || chunkEpochs[chunk] != epoch) {
+        return false;
+    }
+
+    size_t bit = static_cast<size_t>(cluster & (CLUSTERS_PER_CHUNK - 1));
+    return (pool[chunkSlots[chunk] + (bit >> 6)] >> (bit & 63)) & 1;
+}
+
+uint64_t ClusterBitset::insertRange(uint64_t start, uint64_t length, uint64_t* firstDuplicate) {
+    uint64_t duplicates = 0;
+    uint64_t cluster = start;
+    uint64_t end = start + length;
+
+    while (cluster < end) {
+        uint64_t* words = getChunk(cluster);
+        size_t bit = static_cast<size_t>(cluster & (CLUSTERS_PER_CHUNK - 1));
+        uint64_t chunkEnd = (std::min)(end, (cluster | (CLUSTERS_PER_CHUNK - 1)) + 1);
+
+        // Partial words at either end are masked, whole words in between are set in one step
+        while (cluster < chunkEnd) {
+            size_t offset = bit & 63;
+            uint64_t count = (std::min)(static_cast<uint64_t>(64 - offset), chunkEnd - cluster);
+            uint64_t mask = (count == 64) ? ~0ULL : (((1ULL << count) - 1) << offset);
+
+            uint64_t hits = words[bit >> 6] & mask;
+            if (hits && duplicates == 0 && firstDuplicate) {
+                // Position of the lowest set bit, counted as the bits below it
+                *firstDuplicate = cluster - offset + std::bitset<64>((hits & (~hits + 1)) - 1).count();
+            }
+            duplicates += std::bitset<64>(hits).count();
+            words[bit >> 6] |= mask;
+
+            cluster += count;
+            bit += static_cast<size_t>(count);
+        }
+    }
+    return duplicates;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Duplicate-cluster detection for chain validation. Bits live in fixed-size chunks that are only
+// allocated for the parts of the volume a file touches, and clear() is O(1): every chunk carries
+// the epoch it was last written in and is zeroed lazily the next time it is used.
+// One instance is meant to be reused for every file, so the chunk pool is allocated only once.
+class ClusterBitset {
+private:
+    static constexpr uint32_t CHUNK_SHIFT = 15;                          // 32768 clusters per chunk
+    static constexpr uint64_t CLUSTERS_PER_CHUNK = 1ULL << CHUNK_SHIFT;
+    static constexpr size_t WORDS_PER_CHUNK = CLUSTERS_PER_CHUNK / 64;   // 4 KiB of bits
+    static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+
+    std::vector<uint32_t> chunkSlots;   // chunk index -> first word in the pool, NO_CHUNK if never used
+    std::vector<uint32_t> chunkEpochs;  // chunk index -> epoch of its last write
+    std::vector<uint64_t> pool;
+    uint32_t epoch = 1;
+
+    // Returns the words of the chunk covering cluster, allocating or lazily clearing it
+    uint64_t* getChunk(uint64_t cluster);
+
+public:
+    ClusterBitset() = default;
+    // Pre-size the chunk directory for a volume, clusters past it are still accepted
+    explicit ClusterBitset(uint64_t clusterCount);
+
+    // Forget all clusters without touching the chunks
+    void clear();
+    // Mark cluster as used, returns false if it already was
+    bool insert(uint64_t cluster);
+    bool contains(uint64_t cluster) const;
+    // Mark a run of clusters word by word, returns how many of them were already marked.
+    // firstDuplicate, if given, receives the lowest of those clusters
+    uint64_t insertRange(uint64_t start, uint64_t length, uint64_t* firstDuplicate = nullptr);
+};
@@ -1,27 +0,0 @@
-#include "ClusterHistory.h"
-
-
-void ClusterHistory::recordClusterUsage(uint32_t cluster, uint32_t fileId, uint64_t writeOffset) {
-    ClusterUsage usage; 
-    usage.timestamp = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
-    usage.fileId = fileId;
-    usage.isDeleted = true;
-    usage.writeOffset = writeOffset;
-    
-    clusterUsageHistory[cluster].push_back(usage);
-}
-
-std::vector<std::pair<ClusterUsage, ClusterUsage>> ClusterHistory::findOverlappingUsage(uint32_t cluster) {
-    std::vector<std::pair<ClusterUsage, ClusterUsage>> overlaps;
-    auto& history = clusterUsageHistory[cluster];
-
-    for (size_t i = 0; i < history.size(); i++) {
-        for (size_t j = i + 1; j < history.size(); j++) {
-            if (history[i].fileId != history[j].fileId &&
-                history[i].isDeleted && history[j].isDeleted) {
-                overlaps.push_back({ history[i], history[j] });
-            }
-        }
-    }
-    return overlaps;
-}
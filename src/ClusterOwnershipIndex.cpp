@@ -0,0 +1,102 @@
+#include "ClusterOwnershipIndex.h"
+#include <algorithm>
+
+
+void ClusterOwnershipIndex::addOwner(uint32_t owner, const std::vector<ClusterExtent>& extents) {
+    for (const ClusterExtent& extent : extents) {
+        if (extent.sparse || extent.length == 0) continue;
+        ownedExtents.push_back({ extent.start, extent.start + extent.length, owner });
+    }
+    isBuilt = false;
+}
+
+void ClusterOwnershipIndex::build() {
+    collisions.clear();
+
+    // Boundary events sorted by cluster, ends before starts so touching extents don't overlap
+    struct Event {
+        uint64_t cluster;
+        bool isStart;
+        uint32_t owner;
+    };
+    std::vector<Event> events;
+    events.reserve(ownedExtents.size() * 2);
+    for (const OwnedExtent& extent : ownedExtents) {
+        events.push_back({ extent.start, true, extent.owner });
+        events.push_back({ extent.end, false, extent.owner });
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        if (a.cluster != b.cluster) return a.cluster < b.cluster;
+        return !a.isStart && b.isStart;
+    });
+
+    // Owners covering the current position, a file may claim the same cluster more than once
+    std::vector<std::pair<uint32_t, uint32_t>> active; // owner, claim count
+    std::vector<uint32_t> otherOwners;
+
+    size_t i = 0;
+    while (i < events.size()) {
+        uint64_t position = events[i].cluster;
+        for (; i < events.size() && events[i].cluster == position; i++) {
+            auto it = std::find_if(active.begin(), active.end(),
+                [&](const std::pair<uint32_t, uint32_t>& a) { return a.first == events[i].owner; });
+            if (events[i].isStart) {
+                if (it != active.end()) it->second++;
+                else active.push_back({ events[i].owner, 1 });
+            }
+            else if (it != active.end() && --it->second == 0) {
+                active.erase(it);
+            }
+        }
+
+        if (active.size() < 2 || i == events.size()) continue;
+        uint64_t length = events[i].cluster - position;
+
+        // Every owner of the segment gets the range together with everyone else who claims it
+        for (const auto& owner : active) {
+            otherOwners.clear();
+            for (const auto& other : active) {
+                if (other.first != owner.first) otherOwners.push_back(other.first);
+            }
+            std::sort(otherOwners.begin(), otherOwners.end());
+
+            std::vector<ClusterCollision>& ownerCollisions = collisions[owner.first];
+            if (!ownerCollisions.empty() &&
+                ownerCollisions.back().start + ownerCollisions.back().length == position &&
+                ownerCollisions.back().otherOwners == otherOwners) {
+                ownerCollisions.back().length += length; // Same neighbours, extend the previous range
+            }
+            else {
+                ownerCollisions.push_back({ position, length, otherOwners });
+            }
+        }
+    }
+    isBuilt = true;
+}
+
+const std::vector<ClusterCollision>& ClusterOwnershipIndex::getCollisions(uint32_t owner) const {
+    if (!isBuilt) return noCollisions;
+    auto it = collisions.find(owner);
+    return it != collisions.end() ? it->second : noCollisions;
+}
+
+OverwriteAnalysis ClusterOwnershipIndex::analyzeOverwrites(uint32_t owner, uint64_t expectedClusters) const {
+    OverwriteAnalysis analysis = {};
+    analysis.collisions = getCollisions(owner);
+    for (const ClusterCollision& collision : analysis.collisions) {
+        analysis.overwrittenClusters += collision.length;
+    }
+
+    analysis.hasOverwrite = analysis.overwrittenClusters > 0;
+    if (analysis.hasOverwrite && expectedClusters > 0) {
+        analysis.overwritePercentage = (std::min)(100.0,
+            static_cast<double>(analysis.overwrittenClusters) / expectedClusters * 100.0);
+    }
+    return analysis;
+}
+
+void ClusterOwnershipIndex::clear() {
+    ownedExtents.clear();
+    collisions.clear();
+    isBuilt = false;
+}
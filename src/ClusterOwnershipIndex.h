@@ -0,0 +1,34 @@
+#pragma once
+#include "Structures.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+// Maps claimed cluster ranges to the files claiming them. Built once over all candidate files,
+// so every file is compared against all others and not only the ones analyzed before it.
+// While streaming, owners are added and the index rebuilt once per batch
+class ClusterOwnershipIndex {
+private:
+    struct OwnedExtent {
+        uint64_t start;
+        uint64_t end;     // One past the last cluster
+        uint32_t owner;
+    };
+
+    std::vector<OwnedExtent> ownedExtents;
+    std::unordered_map<uint32_t, std::vector<ClusterCollision>> collisions; // owner -> ranges shared with other files
+    std::vector<ClusterCollision> noCollisions;
+    bool isBuilt = false;
+
+public:
+    // Register the extents of one file, sparse extents don't claim anything
+    void addOwner(uint32_t owner, const std::vector<ClusterExtent>& extents);
+    // Sweep all registered extents once and record every range claimed by more than one file
+    void build();
+    // Ranges of owner's clusters also claimed by other files, empty if there are none
+    const std::vector<ClusterCollision>& getCollisions(uint32_t owner) const;
+    // Overwrite summary of one file out of its expected cluster count
+    OverwriteAnalysis analyzeOverwrites(uint32_t owner, uint64_t expectedClusters) const;
+    bool empty() const { return ownedExtents.empty(); }
+    void clear();
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include "Enums.h"
 #include <string>
 #include <cstdint>
 
@@ -25,6 +26,13 @@ public:
     bool createFileDataLog = true;
     bool recover = false;
     bool analyze = false;
+    bool deepScan = false; // keep scanning directory slack past end-of-directory markers
+    bool carve = false; // sweep the data region for directories no longer linked from the tree
+    bool stream = false; // recover files as the scan finds them, every file found is selected
+    OutputSinkType outputSink = OutputSinkType::PLAIN_TYPE; // one file per recovered file, or all of them in one archive
+    std::wstring sinkPath = L""; // archive file or \\.\pipe\<name>, Recovered.tar/.zip in the output folder by default
+    uint32_t readGapKiB = 128; // recovery reads closer than this on disk are merged into one request
+    uint32_t usnJournalDays = 0; // NTFS: only files deleted within this many days, found through $UsnJrnl instead of a full MFT pass
 
 
 };
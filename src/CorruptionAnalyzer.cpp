@@ -0,0 +1,86 @@
+#include "CorruptionAnalyzer.h"
+#include <iostream>
+#include <iomanip>
+#include <set>
+
+
+void CorruptionAnalyzer::applyOverwriteAnalysis(const OverwriteAnalysis& analysis, RecoveryStatus& status, std::wostream& out) {
+    if (!analysis.hasOverwrite) return;
+
+    status.hasOverwrittenClusters = true;
+    status.isCorrupted = true;
+
+    std::set<uint32_t> otherFiles;
+    for (const auto& collision : analysis.collisions) {
+        otherFiles.insert(collision.otherOwners.begin(), collision.otherOwners.end());
+    }
+    out << "  [-] " << analysis.overwrittenClusters << " cluster(s) ("
+        << std::fixed << std::setprecision(2) << analysis.overwritePercentage
+        << "%) also claimed by file ID(s): ";
+    for (uint32_t otherFile : otherFiles) {
+        out << otherFile << " ";
+    }
+    out << std::endl;
+}
+
+bool CorruptionAnalyzer::isFileNameCorrupted(const std::wstring& filename) {
+    if (filename.empty()) return true;
+
+    const std::wstring invalidChars = L"<>:\"/\\|?*";
+    if (filename.find_first_of(invalidChars) != std::wstring::npos) return true;
+
+    int controlCharCount = 0;
+    int unusualCharCount = 0;
+
+    for (wchar_t c : filename) {
+        if (c < 32) controlCharCount++;
+        if (c > 127) unusualCharCount++;
+    }
+
+    // flag as corrupted if half of the filename contains suspicious characters
+    return (controlCharCount > 0 || unusualCharCount > static_cast<int>(filename.length() / 2));
+}
+
+void CorruptionAnalyzer::showAnalysisResult(const RecoveryStatus& status, std::wostream& out) {
+    if (status.isCorrupted) {
+        out << "  [-] Warning: File appears to be corrupted" << std::endl;
+
+        if (status.hasInvalidFileName) {
+            out << "  [-] Filename is corrupted or invalid" << std::endl;
+        }
+        if (status.hasInvalidExtension) {
+            out << "  [-] File extension was either missing or contained invalid characters" << std::endl;
+        }
+
+        // Overwritten by other files
+        if (status.hasOverwrittenClusters) {
+            out << "  [-] Some clusters may have been overwritten" << std::endl;
+            out << "  [-] Problematic clusters: ";
+
+            for (auto cluster : status.problematicClusters) {
+                out << "0x" << std::hex << cluster << " ";
+            }
+            out << std::dec << std::endl;
+        }
+
+        if (status.hasFragmentedClusters) {
+            out << "  [-] Some clusters are fragmented" << std::endl;
+            out << "      - Fragmentation score: "
+                << std::fixed << std::setprecision(2)
+                << (status.fragmentation * 100.0) << "%" << std::endl;
+        }
+        if (status.hasRepeatedClusters) {
+            out << "  [-] Repeated clusters found: "
+                << status.repeatedClusters << std::endl;
+        }
+        if (status.hasBackJumps) {
+            out << "  [-] Backward jumps detected: "
+                << status.backJumps << std::endl;
+        }
+        if (status.hasLargeGaps) {
+            out << "  [-] Large gaps detected: "
+                << status.largeGaps << std::endl;
+        }
+    }
+    else out << "  [+] No signs of corruption found " << std::endl;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "Structures.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+#include <ostream>
+
+// Corruption analysis shared by the FAT32, exFAT and NTFS engines. Everything works on extents,
+// so the cost grows with the number of fragments of a file rather than its number of clusters
+class CorruptionAnalyzer {
+public:
+    static constexpr uint64_t MINIMUM_CLUSTERS_FOR_ANALYSIS = 10; // 5
+    static constexpr uint64_t LARGE_GAP_THRESHOLD = 1000; // 1000
+    static constexpr double SUSPICIOUS_PATTERN_THRESHOLD = 0.1; // 10%
+    static constexpr double SEVERE_PATTERN_THRESHOLD = 0.25;    // 25%
+
+    // Collapse a cluster chain into runs of consecutive clusters
+    template <typename ClusterType>
+    static std::vector<ClusterExtent> buildExtents(const std::vector<ClusterType>& clusterChain);
+
+    // Repeats, backward jumps and large gaps between consecutive extents, and the fragmentation score.
+    // ClusterType is the on-disk cluster width: uint32_t for FAT32/exFAT, uint64_t for NTFS
+    template <typename ClusterType>
+    static void analyzeClusterPattern(const std::vector<ClusterExtent>& extents, RecoveryStatus& status);
+
+    // Merge the ownership index result into status and list the other files
+    static void applyOverwriteAnalysis(const OverwriteAnalysis& analysis, RecoveryStatus& status, std::wostream& out);
+    // Checks if a filename is corrupted
+    static bool isFileNameCorrupted(const std::wstring& filename);
+    static void showAnalysisResult(const RecoveryStatus& status, std::wostream& out);
+};
+
+
+template <typename ClusterType>
+std::vector<ClusterExtent> CorruptionAnalyzer::buildExtents(const std::vector<ClusterType>& clusterChain) {
+    std::vector<ClusterExtent> extents;
+    size_t index = 0;
+    while (index < clusterChain.size()) {
+        size_t runLength = 1;
+        while (index + runLength < clusterChain.size() && clusterChain[index + runLength] == clusterChain[index] + runLength) {
+            runLength++;
+        }
+        extents.push_back({ static_cast<uint64_t>(clusterChain[index]), static_cast<uint64_t>(runLength), false });
+        index += runLength;
+    }
+    return extents;
+}
+
+template <typename ClusterType>
+void CorruptionAnalyzer::analyzeClusterPattern(const std::vector<ClusterExtent>& extents, RecoveryStatus& status) {
+    static_assert(std::is_unsigned<ClusterType>::value, "Cluster numbers are unsigned");
+
+    // Structure of arrays: the last cluster of every extent and the first cluster of every extent.
+    // Sparse runs have no clusters and are left out
+    std::vector<ClusterType> lastClusters;
+    std::vector<ClusterType> firstClusters;
+    lastClusters.reserve(extents.size());
+    firstClusters.reserve(extents.size());
+
+    uint64_t totalClusters = 0;
+    for (const ClusterExtent& extent : extents) {
+        if (extent.sparse || extent.length == 0) continue;
+        totalClusters += extent.length;
+        firstClusters.push_back(static_cast<ClusterType>(extent.start));
+        lastClusters.push_back(static_cast<ClusterType>(extent.start + extent.length - 1));
+    }
+
+    if (totalClusters < MINIMUM_CLUSTERS_FOR_ANALYSIS) {
+        return; // Too few clusters to make reliable assessment
+    }
+
+    // Inside an extent every step is +1, so only the transitions between extents can be anomalies.
+    // The loop is branchless over two flat arrays so the compiler can vectorize it,
+    // 32-bit clusters fit twice as many lanes as 64-bit ones
+    const size_t transitions = firstClusters.size() - 1;
+    const ClusterType* previous = lastClusters.data();
+    const ClusterType* next = firstClusters.data() + 1;
+    const ClusterType largeGap = static_cast<ClusterType>(LARGE_GAP_THRESHOLD);
+
+    ClusterType repeatedClusters = 0;
+    ClusterType backJumps = 0;
+    ClusterType largeGaps = 0;
+    for (size_t i = 0; i < transitions; i++) {
+        ClusterType a = previous[i];
+        ClusterType b = next[i];
+        repeatedClusters += static_cast<ClusterType>(b == a);
+        backJumps += static_cast<ClusterType>(b < a);
+        // gap = b - a - 1 >= threshold
+        largeGaps += static_cast<ClusterType>(b > a) & static_cast<ClusterType>(static_cast<ClusterType>(b - a) > largeGap);
+    }
+
+    status.repeatedClusters += static_cast<uint32_t>(repeatedClusters);
+    status.backJumps += static_cast<uint32_t>(backJumps);
+    status.largeGaps += static_cast<uint32_t>(largeGaps);
+    uint64_t totalAnomalies = static_cast<uint64_t>(repeatedClusters) + backJumps + largeGaps;
+
+    // Calculate overall fragmentation score (0.0 - 1.0)
+    double totalPairs = totalClusters - 1.0;
+    status.fragmentation = (std::min)(1.0, static_cast<double>(totalAnomalies) / totalPairs);
+
+    status.hasLargeGaps = (status.largeGaps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
+    status.hasBackJumps = (status.backJumps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
+    status.hasFragmentedClusters = (status.fragmentation > SEVERE_PATTERN_THRESHOLD);
+    status.hasRepeatedClusters = (status.repeatedClusters > 0);
+
+    if (status.hasBackJumps || status.hasFragmentedClusters || status.hasLargeGaps || status.hasRepeatedClusters) status.isCorrupted = true;
+}
@@ -17,4 +17,10 @@ enum class FilesystemType {
     NTFS_TYPE,
     EXFAT_TYPE,
     EXT4_TYPE
-};
\ No newline at end of file
+};
+
+enum class OutputSinkType {
+    PLAIN_TYPE,
+    TAR_TYPE,
+    ZIP_TYPE
+};
@@ -1,10 +1,13 @@
 
 #include "FAT32Recovery.h"
 #include "LogicalDriveReader.h"
+#include "SimdUtils.h"
 #include <set>
 #include <vector>
+#include <algorithm>
 #include <cwctype>
 #include <codecvt>
+#include <future>
 #include <iostream>
 
 
@@ -70,6 +73,7 @@ void FAT32Recovery::readBootSector(uint32_t sector) {
     uint32_t totalSectors = (driveInfo.bootSector.TotalSectors32 != 0) ? driveInfo.bootSector.TotalSectors32 : driveInfo.bootSector.TotalSectors16;
     uint32_t dataSectors = totalSectors - (driveInfo.bootSector.ReservedSectorCount + (driveInfo.bootSector.NumFATs * driveInfo.bootSector.FATSize32) + rootDirSectors);
     driveInfo.maxClusterCount = dataSectors / driveInfo.bootSector.SectorsPerCluster;
+    workerClusters.assign(scheduler.getWorkerCount(), ClusterBitset(static_cast<uint64_t>(driveInfo.maxClusterCount) + MIN_DATA_CLUSTER));
 }
 uint32_t FAT32Recovery::getBytesPerSector() {
     if (!sectorReader) {
@@ -85,6 +89,9 @@ uint32_t FAT32Recovery::getBytesPerSector() {
 bool FAT32Recovery::readSector(uint64_t sector, void* buffer, uint32_t size) {
     return sectorReader && sectorReader->readSector(sector, buffer, size);
 }
+bool FAT32Recovery::readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize) {
+    return sectorReader && sectorReader->readSectors(sector, sectorCount, buffer, sectorSize);
+}
 
 
 bool FAT32Recovery::isValidCluster(uint32_t cluster) const {
@@ -152,81 +159,183 @@ uint32_t FAT32Recovery::getNextCluster(uint32_t cluster) {
 /*=============== File scan ===============*/
 void FAT32Recovery::scanForDeletedFiles(uint32_t startSector) {
     utils.printHeader("File Search:");
-    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
-        std::cout << "Exitting..." << std::endl;
-        exit(1);
-    }
-
     scanDirectory(driveInfo.rootDirCluster);
+    if (config.carve) {
+        carveOrphanedDirectories();
+    }
 
     utils.closeLogFile();
     utils.printFooter();
 }
 
-void FAT32Recovery::scanDirectory(uint32_t cluster, bool isTargetFolder) {
+void FAT32Recovery::scanDirectory(uint32_t cluster, bool isTargetFolder, bool isDeleted) {
     if (!isValidCluster(cluster)) {
         std::cerr << "Warning: Invalid cluster detected: 0x"
             << std::hex << cluster << std::dec << std::endl;
         return;
     }
 
-    uint32_t sector = clusterToSector(cluster);
-    uint32_t entriesPerSector = driveInfo.bootSector.BytesPerSector / sizeof(DirectoryEntry);
-    std::vector<uint8_t> sectorBuffer(driveInfo.bootSector.BytesPerSector);
-    for (uint64_t i = 0; i < driveInfo.bootSector.SectorsPerCluster; i++) {
-        //sectorBuffer.resize(driveInfo.bootSector.BytesPerSector);
-        
-        if (readSector(static_cast<uint64_t>(sector) + i, sectorBuffer.data(), driveInfo.bootSector.BytesPerSector)) {
-            processEntriesInSector(entriesPerSector, isTargetFolder, sectorBuffer);
+    uint32_t bytesPerCluster = driveInfo.bootSector.SectorsPerCluster * driveInfo.bootSector.BytesPerSector;
+    std::vector<uint8_t> clusterBuffer(bytesPerCluster);
+
+    // LFN runs and the end-of-directory state carry over from one cluster to the next
+    LFNRun lfnRun = {};
+    bool endOfDirectory = false;
+
+    // Walk the chain iteratively, each directory cluster is visited only once
+    while (isValidCluster(cluster) && scannedDirectories.insert(cluster).second) {
+        if (readSectors(clusterToSector(cluster), driveInfo.bootSector.SectorsPerCluster, clusterBuffer.data(), driveInfo.bootSector.BytesPerSector)) {
+            processEntriesInCluster(clusterBuffer, isTargetFolder, isDeleted, lfnRun, endOfDirectory);
         }
         else {
-            std::cerr << "Warning: Failed to read sector " << (sector + i) << std::endl;
+            std::cerr << "Warning: Failed to read cluster " << cluster << std::endl;
         }
-    }
 
-    uint32_t nextCluster = getNextCluster(cluster);
-    if (isValidCluster(nextCluster)) {
-        scanDirectory(nextCluster, isTargetFolder);
+        // Without deep scan nothing past the end marker is of interest
+        if (endOfDirectory && !config.deepScan) break;
+
+        cluster = getNextCluster(cluster);
     }
 }
 
-void FAT32Recovery::processEntriesInSector(uint32_t entriesPerSector, bool isTargetFolder, std::vector<uint8_t>& sectorBuffer) {
-    std::wstring longFilename;
-    for (uint32_t j = 0; j < entriesPerSector; j++) {
-        DirectoryEntry* entry = reinterpret_cast<DirectoryEntry*>(sectorBuffer.data() + j * sizeof(DirectoryEntry));
-        if (entry->Name[0] == 0x00) return; // End of directory
+void FAT32Recovery::processEntriesInCluster(std::vector<uint8_t>& clusterBuffer, bool isTargetFolder, bool isDeletedDirectory, LFNRun& lfnRun, bool& endOfDirectory) {
+    uint32_t entryCount = static_cast<uint32_t>(clusterBuffer.size() / sizeof(DirectoryEntry));
+    uint32_t j = 0;
+
+    for (; j < entryCount && !endOfDirectory; j++) {
+        DirectoryEntry* entry = reinterpret_cast<DirectoryEntry*>(clusterBuffer.data() + j * sizeof(DirectoryEntry));
+        if (entry->Name[0] == 0x00) { // End of directory
+            endOfDirectory = true;
+            break;
+        }
 
         bool isDeleted = entry->Name[0] == 0xE5;
-        if (entry->Attr == 0x0F) { // Long filename
-            longFilename = getLongFilename(entry) + longFilename;
+        if (entry->Attr == LFN_ATTRIBUTE) { // Long filename
+            addLfnFragment(lfnRun, reinterpret_cast<const LFNEntry*>(entry));
             continue;
         }
 
         std::wstring filename;
-        if (!longFilename.empty()) { // LFN
-            filename = longFilename;
-            longFilename.clear();
+        if (lfnRunMatches(lfnRun, entry)) { // LFN
+            filename = getLfnRunName(lfnRun);
         }
-        else { // SFN
+        else { // SFN, orphaned LFN fragments are dropped
             filename = getShortFilename(entry, isDeleted);
         }
+        lfnRun.fragmentCount = 0;
+
+        // Anything inside a deleted directory is gone as well, even if its entries still look in use
+        processDirectoryEntry(entry,  filename, isTargetFolder, isDeletedDirectory);
+    }
 
-        processDirectoryEntry(entry,  filename, isTargetFolder);
+    if (endOfDirectory && config.deepScan) {
+        scanDirectorySlack(clusterBuffer, j, isTargetFolder);
     }
 }
 
-void FAT32Recovery::processDirectoryEntry(const DirectoryEntry* entry, const std::wstring& filename, bool isTargetFolder) {
-    if (!entry) return;
+void FAT32Recovery::scanDirectorySlack(std::vector<uint8_t>& clusterBuffer, uint32_t firstSlot, bool isTargetFolder) {
+    uint32_t entryCount = static_cast<uint32_t>(clusterBuffer.size() / sizeof(DirectoryEntry));
+    if (firstSlot >= entryCount) return;
+
+    // Slack is mostly zeros, the SIMD pre-filter leaves only the slots that hold anything
+    std::vector<uint64_t> slotMask;
+    uint8_t* slackData = clusterBuffer.data() + static_cast<size_t>(firstSlot) * sizeof(DirectoryEntry);
+    if (SimdUtils::buildNonZeroSlotMask(slackData, static_cast<size_t>(entryCount - firstSlot) * sizeof(DirectoryEntry), slotMask) == 0) {
+        return;
+    }
 
-    bool isDeleted = entry->Name[0] == 0xE5;
-    bool isDirectory = entry->Attr & 0x10 && entry->Name[0] != '.';
+    LFNRun lfnRun = {};
+    uint32_t previousSlot = UINT32_MAX;
+
+    for (size_t word = 0; word < slotMask.size(); word++) {
+        uint64_t bits = slotMask[word];
+        while (bits) {
+            uint32_t bit = 0;
+            while (!(bits & (1ULL << bit))) bit++;
+            bits &= bits - 1;
+
+            uint32_t slot = static_cast<uint32_t>(word * 64 + bit);
+            DirectoryEntry* entry = reinterpret_cast<DirectoryEntry*>(slackData + static_cast<size_t>(slot) * sizeof(DirectoryEntry));
+
+            // An empty slot ends any LFN run
+            if (slot != previousSlot + 1) {
+                lfnRun.fragmentCount = 0;
+            }
+            previousSlot = slot;
+
+            if (entry->Attr == LFN_ATTRIBUTE) {
+                addLfnFragment(lfnRun, reinterpret_cast<const LFNEntry*>(entry));
+                continue;
+            }
+
+            if (!isPlausibleDirectoryEntry(entry) || entry->Name[0] == '.') {
+                lfnRun.fragmentCount = 0;
+                continue;
+            }
+
+            std::wstring filename = lfnRunMatches(lfnRun, entry) ? getLfnRunName(lfnRun) : getShortFilename(entry, true);
+            lfnRun.fragmentCount = 0;
+
+            // Anything behind the end marker is no longer part of the directory
+            processDirectoryEntry(entry, filename, isTargetFolder, true);
+        }
+    }
+}
+
+bool FAT32Recovery::isPlausibleDirectoryEntry(const DirectoryEntry* entry) const {
+    static const char invalidChars[] = "\"*+,./:;<=>?[\\]|";
+
+    // Reserved attribute bits, volume labels and LFN entries are not file entries
+    if ((entry->Attr & 0xC0) != 0 || (entry->Attr & 0x08) != 0) return false;
+    // Only the lowercase name/extension flags are defined in NTRes
+    if ((entry->NTRes & ~0x18) != 0) return false;
+
+    for (int i = 0; i < 11; i++) {
+        uint8_t c = entry->Name[i];
+        if (i == 0 && (c == 0xE5 || c == 0x05)) continue;
+        if (c < 0x20 || (c >= 'a' && c <= 'z')) return false;
+        if (c < 0x80 && memchr(invalidChars, c, sizeof(invalidChars) - 1) && !(c == '.' && entry->Name[0] == '.')) return false;
+    }
+    if (entry->Name[0] == ' ') return false;
+
+    // Last write date: month 1-12, day 1-31
+    if (entry->WrtDate != 0) {
+        uint32_t month = (entry->WrtDate >> 5) & 0x0F;
+        uint32_t day = entry->WrtDate & 0x1F;
+        if (month < 1 || month > 12 || day < 1) return false;
+    }
+
+    uint32_t cluster = ((uint32_t)entry->FstClusHI << 16) | entry->FstClusLO;
+    if (cluster == 0) return entry->FileSize == 0;
+    if (!isValidCluster(cluster)) return false;
+    if ((entry->Attr & 0x10) && entry->FileSize != 0) return false;
+
+    uint64_t dataBytes = static_cast<uint64_t>(driveInfo.maxClusterCount) * driveInfo.bootSector.SectorsPerCluster * driveInfo.bootSector.BytesPerSector;
+    return entry->FileSize <= dataBytes;
+}
+
+uint8_t FAT32Recovery::computeShortNameChecksum(const uint8_t* shortName) const {
+    uint8_t checksum = 0;
+    for (int i = 0; i < 11; i++) {
+        checksum = static_cast<uint8_t>(((checksum & 1) ? 0x80 : 0) + (checksum >> 1) + shortName[i]);
+    }
+    return checksum;
+}
+
+void FAT32Recovery::processDirectoryEntry(const DirectoryEntry* entry, const std::wstring& filename, bool isTargetFolder, bool forceDeleted) {
+    // "." and ".." point at this directory and its parent, not at files
+    if (!entry || entry->Name[0] == '.') return;
+
+    bool isDeleted = forceDeleted || entry->Name[0] == 0xE5;
+    bool isDirectory = entry->Attr & 0x10;
 
     uint32_t subDirCluster = ((uint32_t)entry->FstClusHI << 16) | entry->FstClusLO;
     subDirCluster = sanitizeCluster(subDirCluster);
     if (subDirCluster == 0) return;
 
     if (isDirectory) {
-        scanDirectory(subDirCluster, false);
+        // A deleted directory whose cluster has been reallocated holds someone else's live entries
+        scanDirectory(subDirCluster, false, isDeleted && !isClusterInUse(subDirCluster));
     }
     else if (isDeleted) {
         uint32_t fileSize = entry->FileSize;
@@ -237,29 +346,167 @@ void FAT32Recovery::processDirectoryEntry(const DirectoryEntry* entry, const std
     }
 }
 
-void FAT32Recovery::addToRecoveryList(const FAT32FileInfo& fileInfo) {
-    if (config.recover || config.analyze) {
-        recoveryList.push_back(fileInfo);
+void FAT32Recovery::carveOrphanedDirectories() {
+    uint32_t sectorsPerCluster = driveInfo.bootSector.SectorsPerCluster;
+    uint32_t bytesPerSector = driveInfo.bootSector.BytesPerSector;
+    uint32_t bytesPerCluster = sectorsPerCluster * bytesPerSector;
+    uint32_t clustersPerBlock = (std::max)(1u, CARVE_READ_BLOCK_SIZE / bytesPerCluster);
+    uint32_t clusterCount = driveInfo.maxClusterCount - MIN_DATA_CLUSTER + 1;
+    int64_t blockCount = (static_cast<int64_t>(clusterCount) + clustersPerBlock - 1) / clustersPerBlock;
+
+    std::cout << "[*] Carving " << clusterCount << " clusters for orphaned directories..." << std::endl;
+
+    // Every thread sweeps its own blocks with its own buffer, results are merged at the end
+    std::vector<uint32_t> candidates;
+    #pragma omp parallel
+    {
+        std::vector<uint8_t> block(static_cast<size_t>(clustersPerBlock) * bytesPerCluster);
+        std::vector<uint32_t> localCandidates;
+
+        #pragma omp for schedule(dynamic)
+        for (int64_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+            uint32_t firstCluster = MIN_DATA_CLUSTER + static_cast<uint32_t>(blockIndex) * clustersPerBlock;
+            uint32_t count = (std::min)(clustersPerBlock, driveInfo.maxClusterCount - firstCluster + 1);
+            RecoveryScheduler::ReadSlot slot(scheduler, block.size());
+
+            if (readSectors(clusterToSector(firstCluster), count * sectorsPerCluster, block.data(), bytesPerSector)) {
+                for (uint32_t i = 0; i < count; i++) {
+                    if (isDirectoryCluster(block.data() + static_cast<size_t>(i) * bytesPerCluster, bytesPerCluster)) {
+                        localCandidates.push_back(firstCluster + i);
+                    }
+                }
+                continue;
+            }
+
+            // Fall back to single clusters so one bad sector doesn't hide the whole block
+            for (uint32_t i = 0; i < count; i++) {
+                if (readSectors(clusterToSector(firstCluster + i), sectorsPerCluster, block.data(), bytesPerSector) &&
+                    isDirectoryCluster(block.data(), bytesPerCluster)) {
+                    localCandidates.push_back(firstCluster + i);
+                }
+            }
+        }
+
+        #pragma omp critical
+        candidates.insert(candidates.end(), localCandidates.begin(), localCandidates.end());
     }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Clusters reached from the root (or from an earlier orphan) are already done
+    uint32_t orphanCount = 0;
+    for (uint32_t cluster : candidates) {
+        if (scannedDirectories.count(cluster)) continue;
+        orphanCount++;
+        scanDirectory(cluster, false, !isClusterInUse(cluster));
+    }
+
+    std::cout << "[+] Found " << orphanCount << " orphaned directory cluster(s)" << std::endl;
 }
-// Extract long filename from LFN entry
-std::wstring FAT32Recovery::getLongFilename(DirectoryEntry* entry) const {
-    LFNEntry* lfn = reinterpret_cast<LFNEntry*>(entry);
-    std::wstring lfnPart;
-    lfnPart.reserve(13);
-    for (int k = 0; k < 5; k++) lfnPart += lfn->Name1[k];
-    for (int k = 0; k < 6; k++) lfnPart += lfn->Name2[k];
-    for (int k = 0; k < 2; k++) lfnPart += lfn->Name3[k];
 
-    lfnPart.erase(
-        std::remove_if(lfnPart.begin(), lfnPart.end(),
-            [](wchar_t c) {
-                return c == 0 || c == 0xFFFF || c < 32;
-            }),
-        lfnPart.end()
-                );
+bool FAT32Recovery::isDirectoryCluster(const uint8_t* clusterData, uint32_t bytesPerCluster) const {
+    const DirectoryEntry* entries = reinterpret_cast<const DirectoryEntry*>(clusterData);
+    uint32_t entryCount = bytesPerCluster / sizeof(DirectoryEntry);
+    if (entryCount < 2 || entries[0].Name[0] == 0x00) return false;
 
-    return lfnPart;
+    // First cluster of every directory starts with "." and ".."
+    if (memcmp(entries[0].Name, ".          ", 11) == 0 && (entries[0].Attr & 0x10) &&
+        memcmp(entries[1].Name, "..         ", 11) == 0 && (entries[1].Attr & 0x10)) {
+        return true;
+    }
+
+    // Later clusters have no header, every slot up to the end marker has to look like an entry
+    uint32_t fileEntries = 0;
+    for (uint32_t i = 0; i < entryCount; i++) {
+        const DirectoryEntry* entry = &entries[i];
+        if (entry->Name[0] == 0x00) break;
+
+        if (entry->Attr == LFN_ATTRIBUTE) {
+            const LFNEntry* lfn = reinterpret_cast<const LFNEntry*>(entry);
+            uint8_t ordinal = lfn->Ord & 0x1F;
+            if (lfn->Type != 0 || lfn->FstClusLO != 0) return false;
+            if (lfn->Ord != 0xE5 && (ordinal < 1 || ordinal > LFNRun::MAX_FRAGMENTS || (lfn->Ord & 0xA0))) return false;
+            continue;
+        }
+
+        if (!isPlausibleDirectoryEntry(entry)) return false;
+        fileEntries++;
+    }
+    return fileEntries >= MIN_CARVED_ENTRIES;
+}
+
+void FAT32Recovery::addToRecoveryList(const FAT32FileInfo& fileInfo) {
+    if (config.recover || config.analyze) {
+        // While streaming the recovery stage owns the files, nothing is kept for a later selection
+        if (streamQueue) streamQueue->push(fileInfo);
+        else recoveryList.push_back(fileInfo);
+    }
+}
+// Add LFN fragment to the current run, or start a new run if it doesn't continue it
+void FAT32Recovery::addLfnFragment(LFNRun& lfnRun, const LFNEntry* lfn) const {
+    bool isDeleted = lfn->Ord == 0xE5; // Deletion overwrites the ordinal
+    bool isLast = (lfn->Ord & 0x40) != 0;
+    uint8_t ordinal = lfn->Ord & 0x1F;
+
+    // Fragments of one name are stored in descending ordinal order and share the checksum,
+    // anything else is an orphan from another file and starts over
+    bool continuesRun = lfnRun.fragmentCount > 0 &&
+        lfnRun.fragmentCount < LFNRun::MAX_FRAGMENTS &&
+        lfn->Chksum == lfnRun.checksum &&
+        (isDeleted ? lfnRun.expectedCount == 0
+                   : (!isLast && lfnRun.expectedCount != 0 && ordinal == lfnRun.expectedCount - lfnRun.fragmentCount));
+
+    if (!continuesRun) {
+        lfnRun.fragmentCount = 0;
+        lfnRun.checksum = lfn->Chksum;
+        lfnRun.expectedCount = isDeleted ? 0 : ordinal;
+        lfnRun.isValid = isDeleted || (isLast && ordinal >= 1 && ordinal <= LFNRun::MAX_FRAGMENTS);
+    }
+    if (lfn->Type != 0 || lfn->FstClusLO != 0) {
+        lfnRun.isValid = false;
+    }
+
+    uint16_t* fragment = lfnRun.name + (LFNRun::MAX_FRAGMENTS - 1 - lfnRun.fragmentCount) * LFNRun::CHARS_PER_FRAGMENT;
+    memcpy(fragment, lfn->Name1, sizeof(lfn->Name1));
+    memcpy(fragment + 5, lfn->Name2, sizeof(lfn->Name2));
+    memcpy(fragment + 11, lfn->Name3, sizeof(lfn->Name3));
+    lfnRun.fragmentCount++;
+}
+// Check the collected run against the 8.3 entry it precedes
+bool FAT32Recovery::lfnRunMatches(const LFNRun& lfnRun, const DirectoryEntry* entry) const {
+    if (!lfnRun.isValid || lfnRun.fragmentCount == 0) return false;
+
+    if (entry->Name[0] != 0xE5) {
+        return lfnRun.expectedCount == lfnRun.fragmentCount &&
+            computeShortNameChecksum(entry->Name) == lfnRun.checksum;
+    }
+
+    // The first byte of a deleted short name is gone, try the characters it was most likely generated from
+    uint8_t shortName[11];
+    memcpy(shortName, entry->Name, sizeof(shortName));
+    uint16_t firstChar = lfnRun.name[(LFNRun::MAX_FRAGMENTS - lfnRun.fragmentCount) * LFNRun::CHARS_PER_FRAGMENT];
+
+    if (firstChar > 0x20 && firstChar < 0x80) {
+        shortName[0] = static_cast<uint8_t>(std::towupper(firstChar));
+        if (computeShortNameChecksum(shortName) == lfnRun.checksum) return true;
+    }
+    shortName[0] = '_';
+    if (computeShortNameChecksum(shortName) == lfnRun.checksum) return true;
+
+    // Non-ASCII names start with an OEM code page character
+    if (firstChar >= 0x80) {
+        for (uint32_t c = 0x80; c <= 0xFF; c++) {
+            shortName[0] = static_cast<uint8_t>(c);
+            if (computeShortNameChecksum(shortName) == lfnRun.checksum) return true;
+        }
+    }
+    return false;
+}
+// Extract long filename from a complete LFN run
+std::wstring FAT32Recovery::getLfnRunName(const LFNRun& lfnRun) const {
+    std::wstring filename;
+    const uint16_t* name = lfnRun.name + (LFNRun::MAX_FRAGMENTS - lfnRun.fragmentCount) * LFNRun::CHARS_PER_FRAGMENT;
+    SimdUtils::utf16ToWide(name, static_cast<size_t>(lfnRun.fragmentCount) * LFNRun::CHARS_PER_FRAGMENT, filename);
+    return filename;
 }
 // Extract short filename from Directory Entry
 std::wstring FAT32Recovery::getShortFilename(const DirectoryEntry* entry, bool isDeleted) const {
@@ -454,126 +701,21 @@ bool FAT32Recovery::isClusterInUse(uint32_t cluster) {
     uint32_t fatValue = getNextCluster(cluster);
     return (fatValue != 0 && fatValue != 0xF8FFFFFF);
 }
-// Analyzes clusters for repetition, gaps, backward jumps and calculates the fragmentation score
-void FAT32Recovery::analyzeClusterPattern(const std::vector<uint32_t>& clusters, FAT32RecoveryStatus& status) const {
-    //ClusterAnalysisResult result = { 0.0, false, 0, 0, 0 };
-
-    if (clusters.size() < MINIMUM_CLUSTERS_FOR_ANALYSIS) {
-        return; // Too few clusters to make reliable assessment
-    }
-
-    uint32_t totalAnomalies = 0;
-    double avgGapSize = 0;
-    uint32_t gapCount = 0;
-
-    for (size_t i = 1; i < clusters.size(); i++) {
-        uint32_t gap = 0;
-
-        // Check for repeated clusters
-        if (clusters[i] == clusters[i - 1]) {
-            //status.isCorrupted = true;
-            status.repeatedClusters++;
-            totalAnomalies++;
-            continue;
-        }
-
-        // Calculate gap or detect backward jump
-        if (clusters[i] > clusters[i - 1]) {
-            gap = clusters[i] - clusters[i - 1] - 1;
-        }
-        else {
-            //status.isCorrupted = true;
-            status.backJumps++;
-            totalAnomalies++;
-            continue;
-        }
-
-        // Analyze gaps
-        if (gap > 0) {
-            avgGapSize += gap;
-            gapCount++;
-
-            if (gap >= LARGE_GAP_THRESHOLD) {
-                //status.isCorrupted = true;
-                status.largeGaps++;
-                totalAnomalies++;
-            }
-        }
-    }
-
-    // Calculate average gap size if gaps exist
-    if (gapCount > 0) {
-        avgGapSize /= gapCount;
-    }
-
-    // Calculate overall fragmentation score (0.0 - 1.0)
-    double totalPairs = clusters.size() - 1.0;
-    status.fragmentation = (std::min)(1.0, static_cast<double>(totalAnomalies) / totalPairs);
-
-    status.hasLargeGaps = (status.largeGaps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
-    status.hasBackJumps = (status.backJumps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
-    status.hasFragmentedClusters = (status.fragmentation > SEVERE_PATTERN_THRESHOLD);
-    status.hasRepeatedClusters = (status.repeatedClusters > 0);
-
-    if (status.hasBackJumps || status.hasFragmentedClusters || status.hasLargeGaps || status.hasRepeatedClusters) status.isCorrupted = true;
-
-}
-// Checks if a filename is corrupted
-bool FAT32Recovery::isFileNameCorrupted(const std::wstring& filename) const {
-    if (filename.empty()) return true;
-
-    const std::wstring invalidChars = L"<>:\"/\\|?*";
-    if (filename.find_first_of(invalidChars) != std::wstring::npos) return true;
-
-    int controlCharCount = 0;
-    int unusualCharCount = 0;
-
-    for (wchar_t c : filename) {
-        if (c < 32) controlCharCount++;
-        if (c > 127) unusualCharCount++;
-    }
-
-    // flag as corrupted if half of the filename contains suspicious characters
-    return (controlCharCount > 0 || unusualCharCount > static_cast<int>(filename.length() / 2));
-}
-// Calculate the percentage of deleted file being overwritten by another deleted file
-OverwriteAnalysis FAT32Recovery::analyzeClusterOverwrites(uint32_t startCluster, uint32_t expectedSize) {
-    OverwriteAnalysis analysis = {
-        .hasOverwrite = false,
-        .overwritePercentage = 0.0
-    };
+// Resolve the chains of files before any of them is analyzed. Called once for all candidates,
+// or for each batch while streaming, so a batch is compared with every file found so far
+void FAT32Recovery::buildOwnershipIndex(const std::vector<FAT32FileInfo>& files) {
+    std::cout << "[*] Indexing clusters of " << files.size() << " file(s)..." << std::endl;
 
     uint32_t bytesPerCluster = driveInfo.bootSector.SectorsPerCluster * driveInfo.bootSector.BytesPerSector;
-    uint32_t expectedClusters = (expectedSize + bytesPerCluster - 1) / bytesPerCluster;
-
-    uint32_t currentCluster = startCluster;
-    uint64_t currentOffset = 0;
-
-    while (currentOffset < expectedSize && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
-        auto overlaps = clusterHistory.findOverlappingUsage(currentCluster);
-
-        if (!overlaps.empty()) {
-            analysis.hasOverwrite = true;
-            analysis.overwrittenClusters.push_back(currentCluster);
-
-            for (const auto& overlap : overlaps) {
-                analysis.overwrittenBy[currentCluster].push_back(overlap.second.fileId);
-            }
-        }
-
-        clusterHistory.recordClusterUsage(currentCluster, nextFileId, currentOffset);
-
-        currentOffset += bytesPerCluster;
-        currentCluster = getNextCluster(currentCluster);
-    }
+    std::vector<uint32_t> clusterChain;
 
-    if (!analysis.overwrittenClusters.empty()) {
-        analysis.overwritePercentage =
-            static_cast<double>(analysis.overwrittenClusters.size()) / expectedClusters * 100.0;
+    for (const auto& file : files) {
+        if (file.fileSize == 0) continue;
+        clusterChain.clear();
+        resolveClusterChain(file.cluster, (file.fileSize + bytesPerCluster - 1) / bytesPerCluster, clusterChain);
+        ownershipIndex.addOwner(file.fileId, CorruptionAnalyzer::buildExtents(clusterChain));
     }
-
-    nextFileId++;
-    return analysis;
+    ownershipIndex.build();
 }
 
 
@@ -644,61 +786,100 @@ void FAT32Recovery::recoverPartition() {
         selectedDeletedFiles = recoveryList;
     }
 
-    for (const auto& file : selectedDeletedFiles) {
-        processFileForRecovery(file);
+    if (config.analyze) {
+        buildOwnershipIndex(recoveryList);
+    }
+
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results = recoverFiles(selectedDeletedFiles);
+    archive.reset();
+    if (config.recover) RecoveryScheduler::showSummary(results);
+}
+// Chains are resolved and analyzed in parallel, the data is read afterwards in disk order
+std::vector<RecoveryStatus> FAT32Recovery::recoverFiles(const std::vector<FAT32FileInfo>& files) {
+    // Output names are claimed up front, one file after another, so two jobs never pick the same name
+    std::vector<const FAT32FileInfo*> jobs;
+    std::vector<fs::path> outputPaths;
+    for (const auto& file : files) {
+        // Skip files that don't match the target cluster and size (if specified)
+        if (file.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (file.cluster != config.targetCluster || file.fileSize != config.targetFileSize))) {
+            continue;
+        }
+        jobs.push_back(&file);
+        outputPaths.push_back(utils.claimOutputPath(file.fullName, config.outputFolder));
+    }
+
+    std::vector<std::vector<ClusterExtent>> fileExtents(jobs.size());
+    std::vector<RecoveryStatus> results = scheduler.run(jobs.size(), [&](size_t index, uint32_t worker, std::wostream& out) {
+        return processFileForRecovery(*jobs[index], outputPaths[index], workerClusters[worker], fileExtents[index], out);
+    });
+    if (config.recover) {
+        recoverInDiskOrder(jobs, outputPaths, fileExtents, results);
     }
+    return results;
 }
-void FAT32Recovery::processFileForRecovery(const FAT32FileInfo& fileInfo) {
+RecoveryStatus FAT32Recovery::processFileForRecovery(const FAT32FileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::vector<ClusterExtent>& extents, std::wostream& out) {
     bool isExtensionPredicted = false;
 
-    // Skip files that don't match the target cluster and size (if specified)
-    if (fileInfo.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (fileInfo.cluster != config.targetCluster || fileInfo.fileSize != config.targetFileSize))) {
-        return;  
-    }
-    
-    
-    fs::path outputPath = utils.getOutputPath(fileInfo.fullName, config.outputFolder);
-    
     if (fileInfo.fileSize > UINT32_MAX) {
         throw std::overflow_error("File size exceeds 32-bit limit!");
     }
     uint32_t expectedSize = static_cast<uint32_t>(fileInfo.fileSize);
 
-    FAT32RecoveryStatus status = {};
+    RecoveryStatus status = {};
 
     uint32_t bytesPerCluster = driveInfo.bootSector.SectorsPerCluster * driveInfo.bootSector.BytesPerSector;
     status.expectedClusters = (expectedSize + bytesPerCluster - 1) / bytesPerCluster;
 
-    std::wcout << "[*] Current file: " << outputPath.filename() << " cluster " << fileInfo.cluster << " (" << expectedSize << " bytes)" << std::endl;
+    out << "[*] Current file: " << outputPath.filename() << " cluster " << fileInfo.cluster << " (" << expectedSize << " bytes)" << std::endl;
     std::vector<uint32_t> clusterChain;
 
-    validateClusterChain(status, fileInfo.cluster, clusterChain, expectedSize, outputPath, isExtensionPredicted);
+    validateClusterChain(status, fileInfo.fileId, fileInfo.cluster, clusterChain, outputPath, isExtensionPredicted, usedClusters, out);
 
     if (config.recover) {
-        recoverFile(clusterChain, status, outputPath, expectedSize);  
+        extents = CorruptionAnalyzer::buildExtents(clusterChain);
     }
-    utils.printItemDivider();
+    utils.printItemDivider(out);
+    return status;
 }
-// Validates cluster chain and finds potential signs of corruption
-void FAT32Recovery::validateClusterChain(FAT32RecoveryStatus& status, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, uint32_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted){
-    if (config.analyze) std::cout << "[*] Analyzing file clusters..." << std::endl;
-
+// Follows the FAT, falling back to the next cluster where the entry was cleared
+void FAT32Recovery::resolveClusterChain(uint32_t startCluster, uint64_t expectedClusters, std::vector<uint32_t>& clusterChain) {
     uint32_t currentCluster = startCluster;
-    std::set<uint32_t> usedClusters;
-
 
-    while (clusterChain.size() < status.expectedClusters && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
+    while (clusterChain.size() < expectedClusters && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
         clusterChain.push_back(currentCluster);
 
-        if (config.analyze) {
-            // Check for cluster reuse
-            if (usedClusters.find(currentCluster) != usedClusters.end()) {
+        uint32_t nextCluster = getNextCluster(currentCluster);
+
+        if (nextCluster == currentCluster || nextCluster < 2 || nextCluster >= 0x0FFFFFF8) {
+            nextCluster = currentCluster + 1;
+            //status.hasFragmentedClusters = true;
+        }
+
+        currentCluster = nextCluster;
+    }
+}
+// Validates cluster chain and finds potential signs of corruption
+void FAT32Recovery::validateClusterChain(RecoveryStatus& status, uint32_t fileId, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out){
+    if (config.analyze) out << "[*] Analyzing file clusters..." << std::endl;
+
+    resolveClusterChain(startCluster, status.expectedClusters, clusterChain);
+
+    if (config.analyze) {
+        std::vector<ClusterExtent> extents = CorruptionAnalyzer::buildExtents(clusterChain);
+
+        // Check for cluster reuse, a whole run at a time
+        usedClusters.clear();
+        for (const ClusterExtent& extent : extents) {
+            uint64_t duplicate = 0;
+            if (usedClusters.insertRange(extent.start, extent.length, &duplicate) > 0) {
                 status.isCorrupted = true;
                 status.hasOverwrittenClusters = true;
-                status.problematicClusters.push_back(currentCluster);
+                status.problematicClusters.push_back(duplicate);
             }
-            usedClusters.insert(currentCluster);
+        }
 
+        for (uint32_t currentCluster : clusterChain) {
             // Check if cluster is marked as in use by another file
             if (isClusterInUse(currentCluster)) {
                 status.isCorrupted = true;
@@ -706,30 +887,19 @@ void FAT32Recovery::validateClusterChain(FAT32RecoveryStatus& status, const uint
                 status.problematicClusters.push_back(currentCluster);
             }
         }
-       
-
-        uint32_t nextCluster = getNextCluster(currentCluster);
-
-        if (nextCluster == currentCluster || nextCluster < 2 || nextCluster >= 0x0FFFFFF8) {
-            nextCluster = currentCluster + 1;
-            //status.hasFragmentedClusters = true;
-        }
 
-        currentCluster = nextCluster;
-    }
-    if (config.analyze) {
-        auto overwriteAnalysis = analyzeClusterOverwrites(startCluster, expectedSize);
-        status.hasOverwrittenClusters = overwriteAnalysis.hasOverwrite;
-        if (status.hasOverwrittenClusters) status.isCorrupted = true;
+        // Clusters claimed by other deleted files, whichever of them was analyzed first
+        auto overwriteAnalysis = ownershipIndex.analyzeOverwrites(fileId, status.expectedClusters);
+        CorruptionAnalyzer::applyOverwriteAnalysis(overwriteAnalysis, status, out);
 
-        status.hasInvalidFileName = isFileNameCorrupted(outputPath.filename().wstring());
+        status.hasInvalidFileName = CorruptionAnalyzer::isFileNameCorrupted(outputPath.filename().wstring());
         if (status.hasInvalidFileName) {
-            status.isCorrupted;
+            status.isCorrupted = true;
         }
 
         if (!isValidCluster(startCluster)) {
             status.isCorrupted = true;
-            std::cout << "  [-] Invalid starting cluster: 0x" << std::hex << startCluster << std::dec << std::endl;
+            out << "  [-] Invalid starting cluster: 0x" << std::hex << startCluster << std::dec << std::endl;
         }
 
         // Check if extension was either missing or had invalid characters
@@ -738,111 +908,109 @@ void FAT32Recovery::validateClusterChain(FAT32RecoveryStatus& status, const uint
             status.hasInvalidExtension = true;
         }
 
-        analyzeClusterPattern(clusterChain, status);
-        showAnalysisResult(status);
+        CorruptionAnalyzer::analyzeClusterPattern<uint32_t>(extents, status);
+        CorruptionAnalyzer::showAnalysisResult(status, out);
     }
 }
-// Recovers specific file
-void FAT32Recovery::recoverFile(const std::vector<uint32_t>& clusterChain, FAT32RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize) {
-    std::cout << "[*] Recovering file..." << std::endl;
-    std::ofstream outputFile(outputPath, std::ios::binary);
-    if (!outputFile) {
-        throw std::runtime_error("[-] Failed to create output file.");
-    }
-    // Recovery
-    std::vector<uint8_t> sectorBuffer(driveInfo.bootSector.BytesPerSector);
-    for (uint32_t cluster : clusterChain) {
-        uint32_t sector = clusterToSector(cluster);
-
-        for (uint64_t i = 0; i < driveInfo.bootSector.SectorsPerCluster; ++i) {
-            if (!readSector(static_cast<uint64_t>(sector) + i, sectorBuffer.data(), driveInfo.bootSector.BytesPerSector)) {
-                continue;
-            }
+// Reads the chains of all selected files in one pass over the volume
+void FAT32Recovery::recoverInDiskOrder(const std::vector<const FAT32FileInfo*>& files, const std::vector<fs::path>& outputPaths, const std::vector<std::vector<ClusterExtent>>& fileExtents, std::vector<RecoveryStatus>& results) {
+    utils.printHeader("Recovering Files:");
+    uint32_t bytesPerSector = driveInfo.bootSector.BytesPerSector;
+    uint64_t bytesPerCluster = static_cast<uint64_t>(driveInfo.bootSector.SectorsPerCluster) * bytesPerSector;
+    auto clusterToOffset = [this, bytesPerSector](uint64_t cluster) {
+        return static_cast<uint64_t>(clusterToSector(static_cast<uint32_t>(cluster))) * bytesPerSector;
+    };
 
-            uint64_t bytesToWrite = (std::min)(
-                static_cast<uint64_t>(driveInfo.bootSector.BytesPerSector),
-                expectedSize - status.recoveredBytes
-            );
+    ReadPlanner planner;
+    OutputFileCache plainFiles;
+    OutputSink& outputs = archive ? static_cast<OutputSink&>(*archive) : plainFiles;
+    planner.reset(files.size());
+    for (uint32_t i = 0; i < files.size(); i++) {
+        outputs.addFile(i, outputPaths[i], files[i]->fileSize);
+        planner.addFile(i, fileExtents[i], files[i]->fileSize, bytesPerCluster, clusterToOffset);
+    }
 
-            outputFile.write(reinterpret_cast<char*>(sectorBuffer.data()), bytesToWrite);
-            status.recoveredBytes += bytesToWrite;
-            utils.showProgress(status.recoveredBytes, expectedSize);
+    planner.execute(*sectorReader, scheduler, bytesPerSector, static_cast<uint64_t>(config.readGapKiB) * 1024, outputs,
+        [this](uint64_t done, uint64_t total) { utils.showProgress(done, total); });
+    outputs.finish();
 
-            if (status.recoveredBytes >= expectedSize) break;
-        }
-        status.recoveredClusters++;
-        if (status.recoveredBytes >= expectedSize) break;
+    for (uint32_t i = 0; i < files.size(); i++) {
+        const ReadPlanner::FileTotals& totals = planner.getTotals(i);
+        results[i].recoveredBytes = totals.readBytes;
+        results[i].recoveredClusters = (totals.readBytes + bytesPerCluster - 1) / bytesPerCluster;
+        showRecoveryResult(results[i], outputPaths[i], static_cast<uint32_t>(files[i]->fileSize), std::wcout);
     }
-    outputFile.close();
-
-    showRecoveryResult(status, outputPath, expectedSize);
+    utils.printItemDivider();
 }
 
 /* Recovery and analysis results */
-void FAT32Recovery::showAnalysisResult(const FAT32RecoveryStatus& status) const {
-    if (status.isCorrupted) {
-        // std::cout << "\n[*] Recovery Status:" << std::endl;
-        std::cout << "  [-] Warning: File appears to be corrupted" << std::endl;
-
-        if (status.hasInvalidFileName) {
-            std::cout << "  [-] Filename is corrupted or invalid" << std::endl;
-        }
-        if (status.hasInvalidExtension) {
-            std::cout << "  [-] File extension was either missing or contained invalid characters" << std::endl;
-        }
-
-        // Overwritten by other files
-        if (status.hasOverwrittenClusters) {
-            std::cout << "  [-] Some clusters may have been overwritten" << std::endl;
-            std::cout << "  [-] Problematic clusters: ";
-
-            for (auto cluster : status.problematicClusters) {
-                std::cout << "0x" << std::hex << cluster << " ";
-            }
-            std::cout << std::dec << std::endl;
-        }
-
-
-        if (status.hasFragmentedClusters) {
-            std::cout << "  [-] Some clusters are fragmented" << std::endl;
-            std::cout << "      - Fragmentation score: "
-                << std::fixed << std::setprecision(2)
-                << (status.fragmentation) << "%" << std::endl;
-        }
-        if (status.hasRepeatedClusters) {
-            std::cout << "  [-] Repeated clusters found: "
-                << status.repeatedClusters << std::endl;
-        }
-        if (status.hasBackJumps) {
-            std::cout << "  [-] Backward jumps detected: "
-                << status.backJumps << std::endl;
-        }
-        if (status.hasLargeGaps) {
-            std::cout << "  [-] Large gaps detected: "
-                << status.largeGaps << std::endl;
-        }
-    }
-    else std::cout << "  [+] No signs of corruption found " << std::endl;
-}
-void FAT32Recovery::showRecoveryResult(const FAT32RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize) const {
-    std::cout << "\n  [*] Clusters recovered: " << status.recoveredClusters
+void FAT32Recovery::showRecoveryResult(const RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize, std::wostream& out) const {
+    out << "  [*] Clusters recovered: " << status.recoveredClusters
         << " / " << status.expectedClusters << std::endl;
-    std::cout << "  [*] Bytes recovered: " << status.recoveredBytes
+    out << "  [*] Bytes recovered: " << status.recoveredBytes
         << " / " << expectedSize << std::endl;
-    if (fs::exists(fs::absolute(outputPath))) {
-        std::wcout << "  [+] File saved to " << fs::absolute(outputPath) << L"\n";
-    } 
-    else std::wcout << "  [-] Failed to save file" << std::endl;
+    utils.showSavedFile(outputPath, out);
         
     
 }
 
 
 void FAT32Recovery::runLogicalDriveRecovery() {
+    // Asked before the streaming recovery thread is started, so declining leaves nothing running
+    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
+        std::cout << "Exitting..." << std::endl;
+        exit(1);
+    }
+    if (config.stream && (config.recover || config.analyze)) {
+        runStreamingRecovery();
+        return;
+    }
     scanForDeletedFiles(driveInfo.rootDirCluster);
     recoverPartition();
 }
 
+// Recover files while the scan is still running. addToRecoveryList feeds a bounded queue and a
+// recovery thread takes the files off it in batches, so every file found is selected
+void FAT32Recovery::runStreamingRecovery() {
+    streamQueue = std::make_unique<BoundedQueue<FAT32FileInfo>>(RecoveryScheduler::STREAM_QUEUE_CAPACITY);
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results;
+    if (config.analyze) {
+        std::cout << "[!] Streaming: overlaps are only checked against files found so far" << std::endl;
+    }
+
+    auto recovering = std::async(std::launch::async, [this, &results]() {
+        std::vector<FAT32FileInfo> batch;
+        try {
+            while (streamQueue->popBatch(batch, RecoveryScheduler::STREAM_BATCH_FILES)) {
+                if (config.analyze) buildOwnershipIndex(batch);
+                std::vector<RecoveryStatus> batchResults = recoverFiles(batch);
+                results.insert(results.end(), batchResults.begin(), batchResults.end());
+            }
+        }
+        catch (...) {
+            // Don't leave the scanner blocked on a full queue
+            streamQueue->close();
+            throw;
+        }
+    });
+
+    try {
+        scanForDeletedFiles(driveInfo.rootDirCluster);
+    }
+    catch (...) {
+        streamQueue->close();
+        recovering.wait();
+        throw;
+    }
+    streamQueue->close();
+    recovering.get();
+    streamQueue.reset();
+    archive.reset();
+
+    if (config.recover) RecoveryScheduler::showSummary(results);
+}
+
 /*=============== Public Interface ===============*/
 
 /* Recovery entry point */
@@ -3,13 +3,21 @@
 #include "FAT32Structs.h"
 #include "Utils.h"
 #include "SectorReader.h"
-#include "ClusterHistory.h"
+#include "ClusterOwnershipIndex.h"
+#include "ClusterBitset.h"
+#include "CorruptionAnalyzer.h"
+#include "RecoveryScheduler.h"
+#include "ReadPlanner.h"
+#include "OutputFileCache.h"
+#include "BoundedQueue.h"
+#include "ArchiveSink.h"
 #include "Enums.h"
 
 #include <cstdint>
 #include <string>
 #include <windows.h>
 #include <vector>
+#include <unordered_set>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
@@ -28,13 +36,19 @@ private:
     static constexpr const uint32_t MAX_VALID_CLUSTER = 0x0FFFFFF6;
 
     // File corruption analysis
-    static constexpr uint32_t MINIMUM_CLUSTERS_FOR_ANALYSIS = 10; // 5
-    static constexpr uint32_t LARGE_GAP_THRESHOLD = 1000; // 1000
-    static constexpr double SUSPICIOUS_PATTERN_THRESHOLD = 0.1; // 10%
-    static constexpr double SEVERE_PATTERN_THRESHOLD = 0.25;    // 25%
-    static constexpr double FILENAME_CORRUTPION_THRESHOLD = 0.5; // 50% bad chars in name
-    ClusterHistory clusterHistory;// used with finding cluster overwrites
-    uint32_t nextFileId = 0; // used with finding cluster overwrites
+
+    // Directory scan
+    static constexpr uint8_t LFN_ATTRIBUTE = 0x0F;
+    std::unordered_set<uint32_t> scannedDirectories; // directory clusters already visited
+
+    // Orphaned directory carving
+    static constexpr uint32_t CARVE_READ_BLOCK_SIZE = 4 * 1024 * 1024; // Per-thread read size
+    static constexpr uint32_t MIN_CARVED_ENTRIES = 2; // Entries required in a cluster without "." and ".."
+    ClusterOwnershipIndex ownershipIndex; // used with finding cluster overwrites, built over all candidates
+    std::vector<ClusterBitset> workerClusters; // duplicate clusters within one chain, one per recovery worker and cleared per file
+    RecoveryScheduler scheduler; // recovers the selected files in parallel
+    std::unique_ptr<BoundedQueue<FAT32FileInfo>> streamQueue; // files found so far, only while streaming
+    std::unique_ptr<ArchiveSink> archive; // all recovered files, only when writing to an archive
 
     Utils utils;
     //const Config& config;
@@ -46,7 +60,7 @@ private:
         uint32_t maxClusterCount;
     } driveInfo;
 
-    uint16_t fileId = 1;
+    uint32_t fileId = 1;
     std::vector<FAT32FileInfo> recoveryList;
     std::unique_ptr<SectorReader> sectorReader;
     DriveType driveType = DriveType::UNKNOWN_TYPE; // not implemented yet
@@ -55,6 +69,7 @@ private:
 
     void setSectorReader(std::unique_ptr<SectorReader> reader);
     bool readSector(uint64_t sector, void* buffer, uint32_t size);
+    bool readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize);
     void readBootSector(uint32_t sector);
     uint32_t getBytesPerSector();
 
@@ -66,12 +81,25 @@ private:
     /*=============== File scan ===============*/
     // Scan drive for deleted files
     void scanForDeletedFiles(uint32_t startSector);
-    void scanDirectory(uint32_t cluster, bool isTargetFolder = false);
-    void processEntriesInSector(uint32_t entriesPerSector, bool isTargetFolder, std::vector<uint8_t>& sectorBuffer);
-    void processDirectoryEntry(const DirectoryEntry* entry, const std::wstring& filename, bool isTargetFolder);
+    void scanDirectory(uint32_t cluster, bool isTargetFolder = false, bool isDeleted = false);
+    void processEntriesInCluster(std::vector<uint8_t>& clusterBuffer, bool isTargetFolder, bool isDeletedDirectory, LFNRun& lfnRun, bool& endOfDirectory);
+    // Deep scan: examine every non-empty slot past the end-of-directory marker
+    void scanDirectorySlack(std::vector<uint8_t>& clusterBuffer, uint32_t firstSlot, bool isTargetFolder);
+    // Structural checks for entries that can't be trusted (slack, orphaned clusters)
+    bool isPlausibleDirectoryEntry(const DirectoryEntry* entry) const;
+    // 8.3 name checksum stored in every LFN entry
+    uint8_t computeShortNameChecksum(const uint8_t* shortName) const;
+    void processDirectoryEntry(const DirectoryEntry* entry, const std::wstring& filename, bool isTargetFolder, bool forceDeleted = false);
+    // Carving: sweep the data region for directory clusters that can't be reached from the root
+    void carveOrphanedDirectories();
+    bool isDirectoryCluster(const uint8_t* clusterData, uint32_t bytesPerCluster) const;
     void addToRecoveryList(const FAT32FileInfo& fileInfo);
-    // Extract long filename from LFN entry
-    std::wstring getLongFilename(DirectoryEntry* entry) const;
+    // Add LFN fragment to the current run, or start a new run if it doesn't continue it
+    void addLfnFragment(LFNRun& lfnRun, const LFNEntry* lfn) const;
+    // Check the collected run against the 8.3 entry it precedes
+    bool lfnRunMatches(const LFNRun& lfnRun, const DirectoryEntry* entry) const;
+    // Extract long filename from a complete LFN run
+    std::wstring getLfnRunName(const LFNRun& lfnRun) const;
     // Extract short filename from Directory Entry
     std::wstring getShortFilename(const DirectoryEntry* entry, bool isDeleted = false)const;
     // Parse filename into components
@@ -89,31 +117,33 @@ private:
     /*=============== Corruption analysis ===============*/
     // Check if cluster is marked as in use in the FAT
     bool isClusterInUse(uint32_t cluster);
-    // Analyzes clusters for repetition, gaps, backward jumps and calculates the fragmentation score
-    void analyzeClusterPattern(const std::vector<uint32_t>& clusters, FAT32RecoveryStatus& status) const;
-    // Checks if a filename is corrupted
-    bool isFileNameCorrupted(const std::wstring& filename) const;
-    // Find deleted files overwritten by other deleted files
-    OverwriteAnalysis analyzeClusterOverwrites(uint32_t startCluster, uint32_t expectedSize);
+    // Record the clusters claimed by every candidate file, so overwrites are found in both directions
+    void buildOwnershipIndex(const std::vector<FAT32FileInfo>& files);
 
     /*=============== Recovery ===============*/
     // Asks user to either recover all files or only the selected IDs
     std::vector<FAT32FileInfo> selectFilesToRecover(const std::vector<FAT32FileInfo>& deletedFiles);
     // Recover all found deleted files
     void recoverPartition();
-    // Processes each file for recovery based on config options
-    void processFileForRecovery(const FAT32FileInfo& fileInfo);
+    // Analyze and recover one group of files, returns their results in order
+    std::vector<RecoveryStatus> recoverFiles(const std::vector<FAT32FileInfo>& files);
+    // Processes each file for recovery based on config options, runs on a recovery worker
+    // Recovery collects the extents of the chain, the data itself is read by recoverInDiskOrder
+    RecoveryStatus processFileForRecovery(const FAT32FileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::vector<ClusterExtent>& extents, std::wostream& out);
+    // Follow the FAT, falling back to the next cluster where the entry was cleared
+    void resolveClusterChain(uint32_t startCluster, uint64_t expectedClusters, std::vector<uint32_t>& clusterChain);
     // Validate cluster chain and find signs of corruption
-    void validateClusterChain(FAT32RecoveryStatus& status, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, uint32_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted);
-    // Recover specific file
-    void recoverFile(const std::vector<uint32_t>& clusterChain, FAT32RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize);
+    void validateClusterChain(RecoveryStatus& status, uint32_t fileId, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out);
+    // Read the data of all selected files in one sweep sorted by position on the volume
+    void recoverInDiskOrder(const std::vector<const FAT32FileInfo*>& files, const std::vector<fs::path>& outputPaths, const std::vector<std::vector<ClusterExtent>>& fileExtents, std::vector<RecoveryStatus>& results);
 
     /*=============== Recovery and analysis results ===============*/
-    void showAnalysisResult(const FAT32RecoveryStatus& status) const;
-    void showRecoveryResult(const FAT32RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize) const;
+    void showRecoveryResult(const RecoveryStatus& status, const fs::path& outputPath, const uint32_t expectedSize, std::wostream& out) const;
 
     // Recovery entry point
     void runLogicalDriveRecovery();
+    // Scan and recover at the same time, see --stream
+    void runStreamingRecovery();
 
 public:
     // Constructor
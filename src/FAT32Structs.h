@@ -4,7 +4,7 @@
 #include <vector>
 #pragma pack(push, 1)
 struct FAT32FileInfo {
-    uint16_t fileId;
+    uint32_t fileId;
     std::wstring fullName;
     std::wstring fileName;
     std::wstring extension;
@@ -71,6 +71,16 @@ struct LFNEntry {
     uint16_t Name3[2];
 };
 
+// Long filename fragments collected until their short entry is reached
+struct LFNRun {
+    static constexpr uint32_t MAX_FRAGMENTS = 20;       // 255 UTF-16 characters
+    static constexpr uint32_t CHARS_PER_FRAGMENT = 13;
+    uint16_t name[MAX_FRAGMENTS * CHARS_PER_FRAGMENT];  // Filled from the end, fragments arrive last-first
+    uint8_t checksum;       // Short name checksum shared by all fragments
+    uint8_t fragmentCount;
+    uint8_t expectedCount;  // Ordinal of the fragment flagged as last, 0 for deleted runs
+    bool isValid;
+};
 
 struct MBRPartitionEntry {
     uint8_t BootIndicator; // 0x80 for bootable, 0x00 for non-bootable
@@ -120,23 +130,4 @@ struct GPTPartitionEntry {
     uint16_t PartitionName[36];       // Partition name (72 bytes UTF-16LE).
 };
 
-struct FAT32RecoveryStatus {
-    bool isCorrupted;
-    bool hasFragmentedClusters;
-    double fragmentation;
-    bool hasBackJumps;
-    uint32_t backJumps;
-    bool hasRepeatedClusters;
-    uint32_t repeatedClusters;
-    bool hasLargeGaps;
-    uint32_t largeGaps;
-    bool hasOverwrittenClusters;
-    bool hasInvalidFileName;
-    bool hasInvalidExtension;
-    uint64_t expectedClusters;
-    uint64_t recoveredClusters;
-    uint64_t recoveredBytes;
-    std::vector<uint64_t> problematicClusters;
-};
-
 #pragma pack(pop)
\ No newline at end of file
@@ -39,7 +39,8 @@ bool LogicalDriveReader::openDrive() {
         FILE_SHARE_READ,
         NULL,
         OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, // Optimize for random access
+        // Overlapped, so reads from several threads are not serialized on the handle
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS | FILE_FLAG_OVERLAPPED,
         NULL
     );
 
@@ -71,21 +72,59 @@ bool LogicalDriveReader::readSector(uint64_t sector, void* buffer, uint32_t size
         }
     }
 
-    LARGE_INTEGER offset;
-    offset.QuadPart = sector * size;
-    DWORD bytesRead;
+    return readAt(sector * size, buffer, size);
+}
+
+bool LogicalDriveReader::readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize) {
+    if (!isOpen()) {
+        if (!reopen()) {
+            return false;
+        }
+    }
+
+    // Read all sectors at once
+    return readAt(sector * sectorSize, buffer, sectorCount * sectorSize);
+}
 
-    // Set file pointer to sector offset
-    if (!SetFilePointerEx(hDrive, offset, NULL, FILE_BEGIN)) {
+bool LogicalDriveReader::readAt(uint64_t offset, void* buffer, DWORD size) {
+    // Offset is passed with the request instead of moving the shared file pointer,
+    // so concurrent reads on the same handle don't interfere
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    // Each request waits on its own event, another thread's completion can't wake it
+    overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (overlapped.hEvent == NULL) {
         return false;
     }
 
-    // Read the sector
-    if (!ReadFile(hDrive, buffer, size, &bytesRead, NULL) || bytesRead != size) {
+    DWORD bytesRead = 0;
+    BOOL issued = ReadFile(hDrive, buffer, size, &bytesRead, &overlapped);
+    bool completed = waitForRequest(issued, overlapped, bytesRead);
+    CloseHandle(overlapped.hEvent);
+    return completed && bytesRead == size;
+}
+
+bool LogicalDriveReader::deviceControl(DWORD code, void* output, DWORD outputSize) {
+    // The handle is overlapped, so control requests need an OVERLAPPED of their own too
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (overlapped.hEvent == NULL) {
         return false;
     }
 
-    return true;
+    DWORD bytesReturned = 0;
+    BOOL issued = DeviceIoControl(hDrive, code, NULL, 0, output, outputSize, &bytesReturned, &overlapped);
+    bool completed = waitForRequest(issued, overlapped, bytesReturned);
+    CloseHandle(overlapped.hEvent);
+    return completed;
+}
+
+bool LogicalDriveReader::waitForRequest(BOOL issued, OVERLAPPED& overlapped, DWORD& bytesTransferred) {
+    if (!issued && GetLastError() != ERROR_IO_PENDING) {
+        return false;
+    }
+    return GetOverlappedResult(hDrive, &overlapped, &bytesTransferred, TRUE) != FALSE;
 }
 
 uint32_t LogicalDriveReader::getBytesPerSector() {
@@ -96,9 +135,7 @@ uint32_t LogicalDriveReader::getBytesPerSector() {
     }
 
     DISK_GEOMETRY dg = {};
-    DWORD bytesReturned;
-    if (!DeviceIoControl(hDrive, IOCTL_DISK_GET_DRIVE_GEOMETRY,
-        NULL, 0, &dg, sizeof(dg), &bytesReturned, NULL)) {
+    if (!deviceControl(IOCTL_DISK_GET_DRIVE_GEOMETRY, &dg, sizeof(dg))) {
         return 0;
     }
 
@@ -136,16 +173,8 @@ uint64_t LogicalDriveReader::getTotalMftRecords() {
     }
 
     NTFS_VOLUME_DATA_BUFFER nvdb;
-    DWORD bytesReturned;
 
-    if (!DeviceIoControl(hDrive,
-        FSCTL_GET_NTFS_VOLUME_DATA,
-        NULL,
-        0,
-        &nvdb,
-        sizeof(nvdb),
-        &bytesReturned,
-        NULL)) {
+    if (!deviceControl(FSCTL_GET_NTFS_VOLUME_DATA, &nvdb, sizeof(nvdb))) {
         std::cerr << "Failed to get NTFS volume data. Error: " << GetLastError() << std::endl;
         CloseHandle(hDrive);
         return 0;
@@ -12,6 +12,11 @@ private:
     HANDLE hDrive;
     std::wstring drivePath;
     bool openDrive();
+    // Positional read that leaves the file pointer alone
+    bool readAt(uint64_t offset, void* buffer, DWORD size);
+    bool deviceControl(DWORD code, void* output, DWORD outputSize);
+    // Wait for a request issued on the overlapped handle
+    bool waitForRequest(BOOL issued, OVERLAPPED& overlapped, DWORD& bytesTransferred);
 public:
     explicit LogicalDriveReader(const std::wstring& drivePath);
     ~LogicalDriveReader() override;
@@ -26,6 +31,7 @@ public:
 
     // Implement SectorReader interface
     bool readSector(uint64_t sector, void* buffer, uint32_t size) override;
+    bool readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize) override;
     uint32_t getBytesPerSector() override;
     std::wstring getFilesystemType() override;
     uint64_t getTotalMftRecords() override;
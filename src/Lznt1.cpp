@@ -0,0 +1,78 @@
+#include "Lznt1.h"
+#include <cstring>
+
+
+namespace {
+    // Decode one compressed chunk into at most CHUNK_SIZE bytes, returns the number of bytes written or -1
+    long decompressChunk(const uint8_t* source, size_t sourceSize, uint8_t* output, size_t outputSize) {
+        const uint8_t* sourceEnd = source + sourceSize;
+        size_t written = 0;
+
+        while (source < sourceEnd && written < outputSize) {
+            uint8_t flags = *source++;
+
+            for (int token = 0; token < 8 && source < sourceEnd && written < outputSize; token++, flags >>= 1) {
+                if (!(flags & 1)) {
+                    output[written++] = *source++;
+                    continue;
+                }
+
+                if (source + 2 > sourceEnd || written == 0) return -1;
+                uint16_t reference = static_cast<uint16_t>(source[0] | (source[1] << 8));
+                source += 2;
+
+                // The offset field grows as the chunk fills: 4 bits for the first 16 bytes, up to 12 bits
+                uint32_t offsetBits = 4;
+                for (size_t position = written - 1; position >= 0x10; position >>= 1) {
+                    offsetBits++;
+                }
+                uint32_t lengthBits = 16 - offsetBits;
+
+                size_t offset = (reference >> lengthBits) + 1;
+                size_t length = (reference & ((1u << lengthBits) - 1)) + 3;
+                if (offset > written) return -1;
+                if (length > outputSize - written) length = outputSize - written;
+
+                // Overlapping copies repeat the pattern, so this has to go byte by byte
+                uint8_t* destination = output + written;
+                const uint8_t* match = destination - offset;
+                for (size_t i = 0; i < length; i++) {
+                    destination[i] = match[i];
+                }
+                written += length;
+            }
+        }
+        return static_cast<long>(written);
+    }
+}
+
+bool Lznt1::decompressUnit(const uint8_t* source, size_t sourceSize, uint8_t* output, size_t outputSize) {
+    std::memset(output, 0, outputSize);
+
+    size_t sourceOffset = 0;
+    size_t outputOffset = 0;
+    while (sourceOffset + 2 <= sourceSize && outputOffset < outputSize) {
+        uint16_t header = static_cast<uint16_t>(source[sourceOffset] | (source[sourceOffset + 1] << 8));
+        if (header == 0) break; // end of the compressed data
+
+        // Low 12 bits: chunk data size - 1, bit 15: compressed, bits 12-14: always 3
+        size_t chunkSize = (header & 0x0FFF) + 1;
+        bool isCompressed = (header & 0x8000) != 0;
+        sourceOffset += 2;
+        if (sourceOffset + chunkSize > sourceSize) return false;
+
+        size_t room = outputSize - outputOffset;
+        size_t chunkOutput = room < CHUNK_SIZE ? room : CHUNK_SIZE;
+        if (isCompressed) {
+            if (decompressChunk(source + sourceOffset, chunkSize, output + outputOffset, chunkOutput) < 0) return false;
+        }
+        else {
+            std::memcpy(output + outputOffset, source + sourceOffset, chunkSize < chunkOutput ? chunkSize : chunkOutput);
+        }
+
+        // Every chunk but the last stands for a full 4 KiB, a short one is followed by zeros
+        sourceOffset += chunkSize;
+        outputOffset += chunkOutput;
+    }
+    return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// LZNT1, the compression used by NTFS compressed files. A compression unit (usually 16 clusters)
+// holds a sequence of chunks that each expand to at most 4 KiB
+namespace Lznt1 {
+    constexpr size_t CHUNK_SIZE = 4096;
+
+    // Decompress one compression unit. Output past the decompressed data is zero-filled,
+    // returns false if the stream is malformed (the output then holds what could be decoded)
+    bool decompressUnit(const uint8_t* source, size_t sourceSize, uint8_t* output, size_t outputSize);
+}
@@ -0,0 +1,123 @@
+#include "MftDirectoryIndex.h"
+#include <algorithm>
+#include <cwchar>
+
+
+void MftDirectoryIndex::reserve(uint64_t recordCount) {
+    entries.reserve(static_cast<size_t>(recordCount));
+}
+
+void MftDirectoryIndex::add(uint64_t record, uint16_t sequence, uint64_t parentReference, const wchar_t* name, uint8_t nameLength, uint8_t nameType, bool isInUse, bool isDirectory) {
+    if (record >= entries.size()) {
+        entries.resize(static_cast<size_t>(record + 1), Entry{});
+    }
+
+    Entry& entry = entries[static_cast<size_t>(record)];
+    // Keep the Win32/POSIX name over the DOS 8.3 alias of the same file
+    if ((entry.flags & ENTRY_PRESENT) && nameType == 2) return;
+
+    entry.parentRecord = parentReference & REFERENCE_MASK;
+    entry.parentSequence = static_cast<uint16_t>(parentReference >> 48);
+    entry.sequence = sequence;
+    entry.nameType = nameType;
+    entry.flags = ENTRY_PRESENT | (isInUse ? ENTRY_IN_USE : 0) | (isDirectory ? ENTRY_DIRECTORY : 0);
+
+    // Names of the same record are rarely replaced, the old characters are simply left in the pool
+    entry.nameOffset = static_cast<uint32_t>(namePool.size());
+    entry.nameLength = nameLength;
+    namePool.insert(namePool.end(), name, name + nameLength);
+}
+
+bool MftDirectoryIndex::contains(uint64_t record) const {
+    return record < entries.size() && (entries[static_cast<size_t>(record)].flags & ENTRY_PRESENT);
+}
+
+std::wstring MftDirectoryIndex::getName(uint64_t record) const {
+    if (record >= entries.size() || !(entries[static_cast<size_t>(record)].flags & ENTRY_PRESENT)) return L"";
+    const Entry& entry = entries[static_cast<size_t>(record)];
+    return std::wstring(namePool.data() + entry.nameOffset, entry.nameLength);
+}
+
+bool MftDirectoryIndex::isSameFile(uint64_t fileReference) const {
+    uint64_t record = fileReference & REFERENCE_MASK;
+    if (record >= entries.size() || !(entries[static_cast<size_t>(record)].flags & ENTRY_PRESENT)) return false;
+
+    const Entry& entry = entries[static_cast<size_t>(record)];
+    uint16_t sequence = static_cast<uint16_t>(fileReference >> 48);
+    return entry.sequence == sequence || (!(entry.flags & ENTRY_IN_USE) && entry.sequence == static_cast<uint16_t>(sequence + 1));
+}
+
+uint64_t MftDirectoryIndex::getParent(uint64_t record) const {
+    if (record >= entries.size() || !(entries[static_cast<size_t>(record)].flags & ENTRY_PRESENT)) return 0;
+    return entries[static_cast<size_t>(record)].parentRecord;
+}
+
+bool MftDirectoryIndex::isParentOf(uint64_t parentRecord, const Entry& child) const {
+    if (parentRecord >= entries.size()) return false;
+
+    const Entry& parent = entries[static_cast<size_t>(parentRecord)];
+    if (!(parent.flags & ENTRY_PRESENT) || !(parent.flags & ENTRY_DIRECTORY)) return false;
+
+    // The sequence number is bumped when a record is freed, so a deleted parent may be one ahead.
+    // Anything else means the record was reused by an unrelated directory
+    if (child.parentSequence == 0 || parent.sequence == child.parentSequence) return true;
+    return !(parent.flags & ENTRY_IN_USE) && static_cast<uint16_t>(child.parentSequence + 1) == parent.sequence;
+}
+
+std::wstring MftDirectoryIndex::sanitizeName(const wchar_t* name, uint16_t nameLength) {
+    std::wstring result(name, nameLength);
+    for (wchar_t& c : result) {
+        if (c < 32 || wcschr(L"<>:\"/\\|?*", c)) c = L'_';
+    }
+    if (result.empty() || result == L"." || result == L"..") result = L"_";
+    return result;
+}
+
+const std::wstring& MftDirectoryIndex::getParentPath(uint64_t record) {
+    static const std::wstring orphanPath = ORPHAN_FOLDER;
+    static const std::wstring rootPath;
+
+    if (record >= entries.size() || !(entries[static_cast<size_t>(record)].flags & ENTRY_PRESENT)) return orphanPath;
+
+    // Walk up to the root or to the first directory whose path is already known
+    std::vector<uint64_t> chain;
+    const Entry* child = &entries[static_cast<size_t>(record)];
+    uint64_t current = child->parentRecord;
+    const std::wstring* base = &rootPath;
+
+    while (current != ROOT_RECORD) {
+        if (chain.size() >= MAX_PATH_DEPTH || !isParentOf(current, *child) ||
+            std::find(chain.begin(), chain.end(), current) != chain.end()) {
+            base = &orphanPath;
+            break;
+        }
+        auto cached = pathCache.find(current);
+        if (cached != pathCache.end()) {
+            base = &cached->second;
+            break;
+        }
+        chain.push_back(current);
+        child = &entries[static_cast<size_t>(current)];
+        current = child->parentRecord;
+    }
+
+    if (chain.empty()) {
+        return *base;
+    }
+
+    // Build the directories top-down, caching every one of them on the way
+    std::wstring path = *base;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const Entry& directory = entries[static_cast<size_t>(*it)];
+        if (!path.empty()) path += L'\\';
+        path += sanitizeName(namePool.data() + directory.nameOffset, directory.nameLength);
+        pathCache[*it] = path;
+    }
+    return pathCache[chain.front()];
+}
+
+void MftDirectoryIndex::clear() {
+    entries.clear();
+    namePool.clear();
+    pathCache.clear();
+}
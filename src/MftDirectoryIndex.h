@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Record number -> (parent, name) for every MFT record seen during the scan, deleted and live.
+// Names share one character pool so a volume with millions of records stays compact, and
+// directory paths are only built when asked for and then cached
+class MftDirectoryIndex {
+private:
+    static constexpr uint64_t ROOT_RECORD = 5;             // "." of the volume
+    static constexpr uint64_t REFERENCE_MASK = 0x0000FFFFFFFFFFFFULL;
+    static constexpr uint32_t MAX_PATH_DEPTH = 256;        // deeper chains are treated as loops
+
+    struct Entry {
+        uint64_t parentRecord;
+        uint32_t nameOffset;
+        uint16_t nameLength;
+        uint16_t sequence;
+        uint16_t parentSequence;
+        uint8_t  nameType;
+        uint8_t  flags;
+    };
+
+    static constexpr uint8_t ENTRY_PRESENT = 0x01;
+    static constexpr uint8_t ENTRY_IN_USE = 0x02;
+    static constexpr uint8_t ENTRY_DIRECTORY = 0x04;
+
+    std::vector<Entry> entries;
+    std::vector<wchar_t> namePool;
+    std::unordered_map<uint64_t, std::wstring> pathCache; // directory record -> path relative to the root
+
+    bool isParentOf(uint64_t parentRecord, const Entry& child) const;
+    static std::wstring sanitizeName(const wchar_t* name, uint16_t nameLength);
+
+public:
+    static constexpr const wchar_t* ORPHAN_FOLDER = L"$Orphan";
+
+    void reserve(uint64_t recordCount);
+    // Remember one $FILE_NAME of a record. A DOS 8.3 name never replaces a long name
+    void add(uint64_t record, uint16_t sequence, uint64_t parentReference, const wchar_t* name, uint8_t nameLength, uint8_t nameType, bool isInUse, bool isDirectory);
+    bool contains(uint64_t record) const;
+    // Preferred name of record, empty if it is unknown
+    std::wstring getName(uint64_t record) const;
+    // True if the record still holds the file a reference was made to, deleted or not
+    bool isSameFile(uint64_t fileReference) const;
+    // Parent record of record, or 0 if it is unknown
+    uint64_t getParent(uint64_t record) const;
+    // Path of the directory holding record, relative to the volume root. Records whose parent chain
+    // is broken or reused land under ORPHAN_FOLDER
+    const std::wstring& getParentPath(uint64_t record);
+    void clear();
+};
@@ -1,6 +1,13 @@
 #include "NTFSRecovery.h"
 #include <memory>
-#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <iomanip>
+#include <cstddef>
+#include <future>
+#include <chrono>
+#include <iterator>
 
 
 NTFSRecovery::NTFSRecovery(const DriveType& driveType, std::unique_ptr<SectorReader> reader) : IConfigurable(), driveType(driveType) {
@@ -63,6 +70,7 @@ void NTFSRecovery::readBootSector(uint64_t sector) {
 
 
     driveInfo.bytesPerCluster = driveInfo.bootSector.bytesPerSector * driveInfo.bootSector.sectorsPerCluster;
+    driveInfo.totalClusters = driveInfo.bootSector.totalSectors / driveInfo.bootSector.sectorsPerCluster;
 
     // Calculate MFT record size
     // If clustersPerMftRecord is positive, it represents clusters per record
@@ -75,6 +83,7 @@ void NTFSRecovery::readBootSector(uint64_t sector) {
     }
 
     driveInfo.mftOffset = driveInfo.bootSector.mftCluster * driveInfo.bytesPerCluster;
+    driveInfo.totalMftRecords = getTotalMftRecords();
 }
 
 uint32_t NTFSRecovery::getBytesPerSector() {
@@ -132,7 +141,7 @@ bool NTFSRecovery::validateFileInfo(const NTFSFileInfo& fileInfo) const {
         return false;
     }
 
-    if (fileInfo.nonResident && (fileInfo.cluster == 0 || fileInfo.runLength == 0)) {
+    if (fileInfo.nonResident && (fileInfo.cluster == 0 || fileInfo.runs.empty())) {
         //std::cerr << "Data not found in non resident file." << std::endl;
         return false;
     }
@@ -150,8 +159,11 @@ void NTFSRecovery::clearFileInfo(NTFSFileInfo& fileInfo) const {
     fileInfo.fileName = L"";
     fileInfo.fileSize = 0;
     fileInfo.nonResident = false;
-    fileInfo.runLength = 0;
+    fileInfo.runs.clear();
+    fileInfo.compressionUnit = 0;
     fileInfo.data.clear();
+    fileInfo.dataSegments.clear();
+    fileInfo.hasAttributeList = false;
 }
 
 
@@ -171,12 +183,29 @@ bool NTFSRecovery::readMftRecord(std::vector<uint8_t>& mftBuffer, const uint32_t
 void NTFSRecovery::scanForDeletedFiles() {
     utils.printHeader("File Search:");
 
-    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
-        std::cout << "Exitting..." << std::endl;
-        exit(1);
+    // The change journal only leads to the records of recent deletions, the full pass is the fallback
+    bool isJournalScan = config.usnJournalDays && scanUsnJournal();
+    if (!isJournalScan) {
+        scanMFT();
+    }
+
+    if (config.deepScan) {
+        // Index blocks are only collected by the full pass
+        if (isJournalScan) std::cout << "[!] Index slack is only searched on a full MFT scan, skipped" << std::endl;
+        else scanIndexSlack();
+        scanLogFile();
+    }
+
+    if (config.carve) {
+        carveFileRecords();
+        completePendingFiles();
     }
 
-    scanMFT();
+    // Parents may come after their children in the MFT, so paths are resolved once the scan is done
+    for (const auto& file : recoveryList) {
+        utils.logFileInfo(file.fileId, getRelativePath(file), file.fileSize);
+    }
+    logIndexSlackEntries();
     utils.closeLogFile();
     utils.printFooter();
 }
@@ -189,7 +218,9 @@ void NTFSRecovery::scanMFT() {
 
     std::vector<uint8_t> mftBuffer(driveInfo.mftRecordSize);
 
-    uint64_t totalMftRecords = getTotalMftRecords();
+    uint64_t totalMftRecords = driveInfo.totalMftRecords;
+    directoryIndex.clear();
+    directoryIndex.reserve(totalMftRecords);
     for (uint64_t recordIndex = 0; recordIndex < totalMftRecords; recordIndex++) {
         uint64_t currentSector = mftSector + (recordIndex * sectorsPerMftRecord);
 
@@ -197,35 +228,66 @@ void NTFSRecovery::scanMFT() {
             continue;
         }
 
-        processMftRecord(mftBuffer);
+        processMftRecord(mftBuffer, recordIndex);
     }
+
+    completePendingFiles();
 }
 
-void NTFSRecovery::processMftRecord(std::vector<uint8_t>& mftBuffer) {
+void NTFSRecovery::processMftRecord(std::vector<uint8_t>& mftBuffer, uint64_t recordNumber, bool isCarved) {
     try {
         // Process the complete MFT record
         const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
 
         if (!isValidFileRecord(entry)) return;
 
-        // Check if record is in use
+        // A torn record in the live MFT is still worth a try, a carved one is just noise
+        if (!applyFixups(mftBuffer.data(), driveInfo.mftRecordSize) && isCarved) return;
+
+        // Check if record is in use, live records are still walked for their names
         bool isDeleted = (entry->flags & 0x0001) == 0;
-        if (!isDeleted) return;
+
+        // A carved record still marked in use is a copy of a live file, not a deleted one
+        if (isCarved && !isDeleted) return;
+
+        // Extension records only hold overflow attributes of their base record.
+        // Carved ones can't be matched to a base safely and are left out
+        if ((entry->baseFileRecord & MFT_REFERENCE_MASK) != 0) {
+            if (!isCarved) processExtensionRecord(mftBuffer, recordNumber, isDeleted);
+            return;
+        }
 
         NTFSFileInfo fileInfo = {};
+        fileInfo.recordNumber = recordNumber;
+        fileInfo.isCarved = isCarved;
         uint32_t attributeOffset = entry->firstAttributeOffset;
         bool hasFileName = false;
         bool hasData = false;
+        std::vector<NTFSFileInfo> namedStreams;
+
+        processAttribute(mftBuffer, fileInfo, namedStreams, attributeOffset, hasFileName, hasData, isDeleted);
 
-        processAttribute(mftBuffer, fileInfo, attributeOffset, hasFileName, hasData, isDeleted);
+        // Names are known now, so old resident data in the slack can be labelled
+        if (config.deepScan && !isCarved) {
+            processRecordSlack(mftBuffer, recordNumber);
+        }
 
+        if (!isDeleted) return;
+
+        // Named streams found in this record are candidates of their own
+        addNamedStreams(fileInfo, namedStreams);
+
+        // The rest of the file may live in extension records that come later in the MFT
+        if (fileInfo.hasAttributeList) {
+            pendingFiles.push_back(std::move(fileInfo));
+            return;
+        }
         if (!hasFileName && !hasData) return;
 
         
         try {
             if (validateFileInfo(fileInfo)) {
                 addToRecoveryList(fileInfo);
-                utils.logFileInfo(fileInfo.fileId, fileInfo.fileName, fileInfo.fileSize);
                 this->fileId++;
             }
             clearFileInfo(fileInfo);
@@ -242,7 +304,832 @@ void NTFSRecovery::processMftRecord(std::vector<uint8_t>& mftBuffer) {
     }
 }
 
-void NTFSRecovery::processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSFileInfo& fileInfo, uint32_t attributeOffset, bool& hasFileName, bool& hasData, bool isDeleted) {
+bool NTFSRecovery::applyFixups(uint8_t* block, uint32_t blockSize) const {
+    // FILE and INDX headers share the signature and update sequence fields
+    const MFTEntryHeader* header = reinterpret_cast<const MFTEntryHeader*>(block);
+    uint32_t strides = blockSize / FIXUP_STRIDE;
+    if (header->updateSequenceSize != strides + 1 ||
+        header->updateSequenceOffset + header->updateSequenceSize * sizeof(uint16_t) > blockSize) {
+        return false;
+    }
+
+    // First value is the sequence number every stride ends with, then the original bytes of each stride
+    uint16_t* updateSequence = reinterpret_cast<uint16_t*>(block + header->updateSequenceOffset);
+    bool isIntact = true;
+    for (uint32_t i = 0; i < strides; i++) {
+        uint16_t* strideEnd = reinterpret_cast<uint16_t*>(block + (i + 1) * FIXUP_STRIDE - sizeof(uint16_t));
+        if (*strideEnd != updateSequence[0]) isIntact = false;
+        *strideEnd = updateSequence[i + 1];
+    }
+    return isIntact;
+}
+
+bool NTFSRecovery::isPlausibleFileRecord(const uint8_t* record) const {
+    const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(record);
+    if (!isValidFileRecord(entry)) return false;
+
+    return entry->allocatedSize == driveInfo.mftRecordSize &&
+        entry->usedSize <= entry->allocatedSize && entry->usedSize % 8 == 0 &&
+        entry->firstAttributeOffset >= offsetof(MFTEntryHeader, recordNumber) && entry->firstAttributeOffset < entry->usedSize &&
+        entry->updateSequenceOffset % 2 == 0 && entry->updateSequenceOffset >= offsetof(MFTEntryHeader, logFileSequenceNumber) &&
+        entry->updateSequenceOffset + entry->updateSequenceSize * sizeof(uint16_t) <= entry->firstAttributeOffset &&
+        entry->updateSequenceSize == driveInfo.mftRecordSize / FIXUP_STRIDE + 1;
+}
+
+// Look for FILE records outside the current MFT: leftovers of an older MFT after a reformat,
+// or of an MFT that was moved or shrunk
+void NTFSRecovery::carveFileRecords() {
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    uint32_t sectorsPerBlock = CARVE_READ_BLOCK_SIZE / bytesPerSector;
+    uint32_t recordsPerBlock = CARVE_READ_BLOCK_SIZE / driveInfo.mftRecordSize;
+    uint64_t totalSectors = driveInfo.bootSector.totalSectors;
+    int64_t blockCount = static_cast<int64_t>((totalSectors + sectorsPerBlock - 1) / sectorsPerBlock);
+
+    // The live MFT was already scanned record by record, its mirror only repeats the first records
+    std::vector<std::pair<uint64_t, uint64_t>> liveRanges = getLiveMftRanges();
+    auto isLiveMft = [&liveRanges](uint64_t offset) {
+        auto next = std::upper_bound(liveRanges.begin(), liveRanges.end(), offset,
+            [](uint64_t value, const std::pair<uint64_t, uint64_t>& range) { return value < range.first; });
+        return next != liveRanges.begin() && offset < std::prev(next)->second;
+    };
+
+    std::cout << "[*] Carving " << totalSectors << " sectors for FILE records..." << std::endl;
+
+    // Threads sweep their own blocks, matching records go through the normal path one at a time
+    uint64_t carvedCount = 0;
+    #pragma omp parallel
+    {
+        std::vector<uint8_t> block(CARVE_READ_BLOCK_SIZE);
+        std::vector<uint8_t> record(driveInfo.mftRecordSize);
+
+        #pragma omp for schedule(dynamic) reduction(+:carvedCount)
+        for (int64_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+            uint64_t firstSector = static_cast<uint64_t>(blockIndex) * sectorsPerBlock;
+            uint32_t sectorCount = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(sectorsPerBlock), totalSectors - firstSector));
+            uint32_t recordCount = (std::min)(recordsPerBlock, sectorCount * bytesPerSector / driveInfo.mftRecordSize);
+            {
+                // Released before the records are handed on, a streaming push may block on the queue
+                RecoveryScheduler::ReadSlot slot(scheduler, block.size());
+                if (!sectorReader->readSectors(firstSector, sectorCount, block.data(), bytesPerSector)) continue;
+            }
+
+            for (uint32_t i = 0; i < recordCount; i++) {
+                uint64_t offset = firstSector * bytesPerSector + static_cast<uint64_t>(i) * driveInfo.mftRecordSize;
+                if (isLiveMft(offset)) continue;
+
+                const uint8_t* candidate = block.data() + static_cast<size_t>(i) * driveInfo.mftRecordSize;
+                if (!isPlausibleFileRecord(candidate)) continue;
+
+                std::memcpy(record.data(), candidate, driveInfo.mftRecordSize);
+                const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(record.data());
+                #pragma omp critical
+                processMftRecord(record, entry->recordNumber, true);
+                carvedCount++;
+            }
+        }
+    }
+
+    std::cout << "[+] Found " << carvedCount << " FILE record(s) outside the MFT" << std::endl;
+}
+
+// Byte ranges of $MFT and $MFTMirr, sorted by start. Taken from their run lists so every
+// fragment is covered, the boot sector only knows where the first one starts
+std::vector<std::pair<uint64_t, uint64_t>> NTFSRecovery::getLiveMftRanges() {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    uint64_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    uint32_t sectorsPerMftRecord = getSectorsPerMftRecord();
+    bool hasMftRuns = false;
+    std::vector<uint8_t> mftBuffer(driveInfo.mftRecordSize);
+
+    // Both records sit at the start of the first MFT extent
+    for (uint64_t record : { MFT_RECORD_NUMBER, MFTMIRR_RECORD_NUMBER }) {
+        uint64_t recordSector = clusterToSector(driveInfo.bootSector.mftCluster) + record * sectorsPerMftRecord;
+        if (!isValidSector(recordSector) || !readMftRecord(mftBuffer, sectorsPerMftRecord, recordSector)) continue;
+        applyFixups(mftBuffer.data(), driveInfo.mftRecordSize);
+
+        const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+        if (!isValidFileRecord(entry)) continue;
+
+        // Find the unnamed non-resident $DATA attribute
+        std::vector<ClusterExtent> runs;
+        uint32_t attributeOffset = entry->firstAttributeOffset;
+        while (attributeOffset + sizeof(AttributeHeader) <= driveInfo.mftRecordSize) {
+            const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(mftBuffer.data() + attributeOffset);
+            if (attr->type == 0xFFFFFFFF) break;
+            if (attr->length == 0 || attributeOffset + attr->length > driveInfo.mftRecordSize) break;
+
+            if (attr->type == 0x80 && attr->nonResident && attr->nameLength == 0) {
+                parseDataRuns(attr, mftBuffer.data() + attributeOffset, runs);
+                break;
+            }
+            attributeOffset += attr->length;
+        }
+
+        for (const ClusterExtent& run : runs) {
+            if (run.sparse) continue;
+            uint64_t start = clusterToSector(run.start) * bytesPerSector;
+            ranges.emplace_back(start, start + run.length * driveInfo.bytesPerCluster);
+            if (record == MFT_RECORD_NUMBER) hasMftRuns = true;
+        }
+    }
+
+    // Unreadable $MFT record, fall back to the extent the boot sector points at
+    if (!hasMftRuns) {
+        uint64_t mftStart = clusterToSector(driveInfo.bootSector.mftCluster) * bytesPerSector;
+        ranges.emplace_back(mftStart, mftStart + driveInfo.totalMftRecords * driveInfo.mftRecordSize);
+    }
+
+    std::sort(ranges.begin(), ranges.end());
+    return ranges;
+}
+
+// Records that shrank (e.g. a small file that grew out of its resident $DATA) keep their old
+// attributes past usedSize. Resident $DATA found there is offered as a "$Slack" stream
+void NTFSRecovery::processRecordSlack(const std::vector<uint8_t>& mftBuffer, uint64_t recordNumber) {
+    const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+    if (entry->usedSize >= driveInfo.mftRecordSize) return;
+
+    // The end marker and whatever the last stride fixup covers are not attribute data
+    uint32_t slackEnd = driveInfo.mftRecordSize - sizeof(uint16_t);
+    for (uint32_t offset = (entry->usedSize + 7) & ~7u; offset + sizeof(ResidentAttributeHeader) <= slackEnd; offset += 8) {
+        const ResidentAttributeHeader* attr = reinterpret_cast<const ResidentAttributeHeader*>(mftBuffer.data() + offset);
+        if (attr->type != 0x80 || attr->nonResident || attr->nameLength != 0) continue;
+        if (attr->length < sizeof(ResidentAttributeHeader) || attr->length % 8 != 0 || offset + attr->length > slackEnd) continue;
+        if (attr->contentLength == 0 || attr->contentOffset < sizeof(ResidentAttributeHeader) ||
+            attr->contentOffset + static_cast<uint64_t>(attr->contentLength) > attr->length) continue;
+
+        NTFSFileInfo slackInfo = {};
+        slackInfo.fileName = directoryIndex.getName(recordNumber);
+        slackInfo.streamName = L"$Slack";
+        slackInfo.recordNumber = recordNumber;
+        slackInfo.fileId = fileId;
+        slackInfo.fileSize = attr->contentLength;
+        const uint8_t* content = mftBuffer.data() + offset + attr->contentOffset;
+        slackInfo.data.assign(content, content + attr->contentLength);
+
+        if (!slackInfo.fileName.empty() && validateFileInfo(slackInfo)) {
+            addToRecoveryList(slackInfo);
+            this->fileId++;
+        }
+        return; // an older copy further on would only repeat what was found
+    }
+}
+
+void NTFSRecovery::queueIndexAllocation(const AttributeHeader* attr, const uint8_t* attrData, uint64_t directoryRecord) {
+    // Only the filename index ($I30) holds $FILE_NAME keys
+    if (attr->nameLength != 4 || attr->nameOffset + 4 * sizeof(uint16_t) > attr->length) return;
+    const uint16_t* name = reinterpret_cast<const uint16_t*>(attrData + attr->nameOffset);
+    if (name[0] != L'$' || name[1] != L'I' || name[2] != L'3' || name[3] != L'0') return;
+
+    IndexAllocation allocation = { directoryRecord, {} };
+    parseDataRuns(attr, attrData, allocation.runs);
+    if (!allocation.runs.empty()) {
+        indexAllocations.push_back(std::move(allocation));
+    }
+}
+
+// Read every directory's INDX blocks once, in large reads, and carve $FILE_NAME keys from their slack
+void NTFSRecovery::scanIndexSlack() {
+    int8_t clustersPerIndexBlock = driveInfo.bootSector.clustersPerIndexBlock;
+    uint32_t indexBlockSize = clustersPerIndexBlock > 0
+        ? clustersPerIndexBlock * driveInfo.bytesPerCluster
+        : 1u << (-1 * clustersPerIndexBlock);
+    if (indexBlockSize < FIXUP_STRIDE || indexBlockSize > INDEX_READ_BLOCK_SIZE) return;
+
+    std::cout << "[*] Scanning index slack of " << indexAllocations.size() << " director" << (indexAllocations.size() == 1 ? "y" : "ies") << "..." << std::endl;
+
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    uint32_t blocksPerRead = INDEX_READ_BLOCK_SIZE / indexBlockSize;
+    std::vector<uint8_t> buffer(static_cast<size_t>(blocksPerRead) * indexBlockSize);
+    std::vector<IndexSlackEntry> found;
+
+    for (const IndexAllocation& allocation : indexAllocations) {
+        found.clear();
+        for (const ClusterExtent& run : allocation.runs) {
+            if (run.sparse) continue;
+
+            uint64_t runOffset = 0;
+            uint64_t runBytes = run.length * driveInfo.bytesPerCluster;
+            while (runOffset + indexBlockSize <= runBytes) {
+                uint32_t blockCount = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(blocksPerRead), (runBytes - runOffset) / indexBlockSize));
+                uint32_t readSize = blockCount * indexBlockSize;
+                uint64_t sector = clusterToSector(run.start) + runOffset / bytesPerSector;
+
+                if (sectorReader->readSectors(sector, readSize / bytesPerSector, buffer.data(), bytesPerSector)) {
+                    for (uint32_t i = 0; i < blockCount; i++) {
+                        uint8_t* indexBlock = buffer.data() + static_cast<size_t>(i) * indexBlockSize;
+                        const IndexBlockHeader* header = reinterpret_cast<const IndexBlockHeader*>(indexBlock);
+                        if (header->signature != INDX_SIGNATURE || !applyFixups(indexBlock, indexBlockSize)) continue;
+                        carveIndexSlack(indexBlock, indexBlockSize, allocation.directoryRecord, found);
+                    }
+                }
+                runOffset += readSize;
+            }
+        }
+
+        // Copies of the same entry pile up as the index is rebalanced
+        size_t directoryStart = indexSlackEntries.size();
+        for (const IndexSlackEntry& entry : found) {
+            bool isDuplicate = std::any_of(indexSlackEntries.begin() + directoryStart, indexSlackEntries.end(),
+                [&entry](const IndexSlackEntry& other) {
+                    return other.fileReference == entry.fileReference && other.fileName == entry.fileName;
+                });
+            if (!isDuplicate) indexSlackEntries.push_back(entry);
+        }
+    }
+
+    indexAllocations.clear();
+    indexAllocations.shrink_to_fit();
+}
+
+void NTFSRecovery::carveIndexSlack(const uint8_t* indexBlock, uint32_t indexBlockSize, uint64_t directoryRecord, std::vector<IndexSlackEntry>& found) const {
+    const IndexBlockHeader* header = reinterpret_cast<const IndexBlockHeader*>(indexBlock);
+    const size_t nodeOffset = offsetof(IndexBlockHeader, entriesOffset);
+    size_t slackStart = nodeOffset + header->indexLength;
+    size_t slackEnd = (std::min)(nodeOffset + static_cast<size_t>(header->allocatedSize), static_cast<size_t>(indexBlockSize));
+    if (header->indexLength > header->allocatedSize) return;
+
+    const size_t keyOffset = sizeof(IndexEntryHeader);
+    const size_t nameOffset = offsetof(FileNameAttribute, name);
+
+    for (size_t offset = (slackStart + 7) & ~static_cast<size_t>(7); offset + keyOffset + nameOffset <= slackEnd; offset += 8) {
+        const IndexEntryHeader* entry = reinterpret_cast<const IndexEntryHeader*>(indexBlock + offset);
+        const FileNameAttribute* key = reinterpret_cast<const FileNameAttribute*>(indexBlock + offset + keyOffset);
+
+        // A real key points back at this directory, so most noise is rejected by the first check
+        if ((key->parentDirectory & MFT_REFERENCE_MASK) != directoryRecord) continue;
+        if (key->nameLength == 0 || key->nameType > 3) continue;
+        if (entry->keyLength < nameOffset + key->nameLength * sizeof(uint16_t)) continue;
+        if (offset + keyOffset + nameOffset + key->nameLength * sizeof(uint16_t) > slackEnd) continue;
+        if (key->creationTime < MIN_PLAUSIBLE_FILETIME || key->creationTime > MAX_PLAUSIBLE_FILETIME ||
+            key->modificationTime < MIN_PLAUSIBLE_FILETIME || key->modificationTime > MAX_PLAUSIBLE_FILETIME) continue;
+
+        const uint16_t* name = reinterpret_cast<const uint16_t*>(indexBlock + offset + keyOffset + nameOffset);
+        std::wstring fileName(name, name + key->nameLength);
+        if (std::any_of(fileName.begin(), fileName.end(), [](wchar_t c) { return c < 32; })) continue;
+
+        // The record may still describe this very file, then the MFT pass has it already
+        if (directoryIndex.isSameFile(entry->fileReference)) continue;
+        // The DOS alias adds nothing next to the long name
+        if (key->nameType == 2) continue;
+
+        found.push_back({ fileName, entry->fileReference, directoryRecord, key->realSize, key->creationTime, key->modificationTime });
+    }
+}
+
+void NTFSRecovery::logIndexSlackEntries() {
+    if (indexSlackEntries.empty()) return;
+
+    std::cout << "[+] " << indexSlackEntries.size() << " deleted name(s) found in index slack, their data is no longer referenced:" << std::endl;
+    for (const IndexSlackEntry& entry : indexSlackEntries) {
+        const std::wstring& parentPath = directoryIndex.getParentPath(entry.parentRecord);
+        std::wstring directoryName = directoryIndex.getName(entry.parentRecord);
+        std::wstring path = parentPath.empty() ? directoryName : parentPath + L"\\" + directoryName;
+        if (entry.parentRecord == 5) path.clear(); // volume root
+
+        std::wcout << L"  [+] \"" << (path.empty() ? entry.fileName : path + L"\\" + entry.fileName) << L"\" ("
+            << entry.fileSize << L" bytes, record " << (entry.fileReference & MFT_REFERENCE_MASK)
+            << L", created " << formatFileTime(entry.creationTime)
+            << L", modified " << formatFileTime(entry.modificationTime) << L")" << std::endl;
+    }
+}
+
+// FILETIME (100 ns ticks since 1601-01-01) as "YYYY-MM-DD HH:MM:SS" UTC
+std::wstring NTFSRecovery::formatFileTime(uint64_t fileTime) {
+    int64_t seconds = static_cast<int64_t>(fileTime / 10000000ULL) - 11644473600LL; // to Unix time
+    int64_t days = seconds / 86400;
+    int64_t secondOfDay = seconds % 86400;
+    if (secondOfDay < 0) {
+        secondOfDay += 86400;
+        days--;
+    }
+
+    // Civil date from days since 1970-01-01
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    wchar_t text[32];
+    swprintf(text, 32, L"%04lld-%02lld-%02lld %02lld:%02lld:%02lld", static_cast<long long>(year), static_cast<long long>(month), static_cast<long long>(day),
+        static_cast<long long>(secondOfDay / 3600), static_cast<long long>((secondOfDay / 60) % 60), static_cast<long long>(secondOfDay % 60));
+    return text;
+}
+
+/* Change journal */
+// Records are read straight from the MFT location, like the full pass does
+bool NTFSRecovery::readMftRecordByNumber(uint64_t record, std::vector<uint8_t>& mftBuffer) {
+    uint32_t sectorsPerMftRecord = getSectorsPerMftRecord();
+    uint64_t sector = clusterToSector(driveInfo.bootSector.mftCluster) + record * sectorsPerMftRecord;
+    if (record >= driveInfo.totalMftRecords || sector >= driveInfo.bootSector.totalSectors) return false;
+
+    mftBuffer.resize(driveInfo.mftRecordSize);
+    return readMftRecord(mftBuffer, sectorsPerMftRecord, sector);
+}
+
+const AttributeHeader* NTFSRecovery::findAttribute(const std::vector<uint8_t>& mftBuffer, uint32_t type, const std::wstring& name) const {
+    const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+    uint32_t attributeOffset = entry->firstAttributeOffset;
+
+    while (attributeOffset + sizeof(AttributeHeader) <= driveInfo.mftRecordSize) {
+        const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(mftBuffer.data() + attributeOffset);
+        if (attr->type == 0xFFFFFFFF) break;
+        if (attr->length == 0 || attributeOffset + attr->length > driveInfo.mftRecordSize) break;
+
+        if (attr->type == type && attr->nameLength == name.size() && attr->nameOffset + attr->nameLength * sizeof(uint16_t) <= attr->length) {
+            const uint16_t* attrName = reinterpret_cast<const uint16_t*>(mftBuffer.data() + attributeOffset + attr->nameOffset);
+            if (std::equal(name.begin(), name.end(), attrName, [](wchar_t a, uint16_t b) { return a == static_cast<wchar_t>(b); })) {
+                return attr;
+            }
+        }
+        attributeOffset += attr->length;
+    }
+    return nullptr;
+}
+
+// node points at the entriesOffset field of an index root or INDX block
+bool NTFSRecovery::findIndexEntry(const uint8_t* node, size_t nodeSize, const std::wstring& name, uint64_t& fileReference) const {
+    if (nodeSize < 2 * sizeof(uint32_t)) return false;
+    uint32_t entriesOffset = *reinterpret_cast<const uint32_t*>(node);
+    size_t end = (std::min)(static_cast<size_t>(*reinterpret_cast<const uint32_t*>(node + sizeof(uint32_t))), nodeSize);
+    const size_t nameOffset = offsetof(FileNameAttribute, name);
+
+    size_t offset = entriesOffset;
+    while (offset + sizeof(IndexEntryHeader) <= end) {
+        const IndexEntryHeader* entry = reinterpret_cast<const IndexEntryHeader*>(node + offset);
+        if (entry->entryLength < sizeof(IndexEntryHeader) || offset + entry->entryLength > end) break;
+        if (entry->flags & 0x02) break; // last entry carries no key
+
+        const FileNameAttribute* key = reinterpret_cast<const FileNameAttribute*>(node + offset + sizeof(IndexEntryHeader));
+        if (entry->keyLength >= nameOffset + key->nameLength * sizeof(uint16_t) && key->nameLength == name.size()) {
+            const uint16_t* keyName = reinterpret_cast<const uint16_t*>(node + offset + sizeof(IndexEntryHeader) + nameOffset);
+            if (std::equal(name.begin(), name.end(), keyName, [](wchar_t a, uint16_t b) { return a == static_cast<wchar_t>(b); })) {
+                fileReference = entry->fileReference;
+                return true;
+            }
+        }
+        offset += entry->entryLength;
+    }
+    return false;
+}
+
+// $Extend\$UsnJrnl has no fixed record number, look it up in the $Extend index and return the runs of $J
+bool NTFSRecovery::findUsnJournal(std::vector<ClusterExtent>& runs, uint64_t& streamSize) {
+    std::vector<uint8_t> mftBuffer;
+    if (!readMftRecordByNumber(EXTEND_RECORD_NUMBER, mftBuffer)) return false;
+    applyFixups(mftBuffer.data(), driveInfo.mftRecordSize);
+    if (!isValidFileRecord(reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data()))) return false;
+
+    const std::wstring journalName = L"$UsnJrnl";
+    uint64_t journalReference = 0;
+    bool isFound = false;
+
+    // $Extend holds a handful of entries, usually all in the index root
+    const AttributeHeader* root = findAttribute(mftBuffer, 0x90, L"$I30");
+    if (root && !root->nonResident) {
+        const ResidentAttributeHeader* resident = reinterpret_cast<const ResidentAttributeHeader*>(root);
+        if (resident->contentOffset + static_cast<uint64_t>(resident->contentLength) <= root->length &&
+            resident->contentLength >= sizeof(IndexRootHeader)) {
+            const uint8_t* content = reinterpret_cast<const uint8_t*>(root) + resident->contentOffset;
+            size_t nodeOffset = offsetof(IndexRootHeader, entriesOffset);
+            isFound = findIndexEntry(content + nodeOffset, resident->contentLength - nodeOffset, journalName, journalReference);
+        }
+    }
+
+    const AttributeHeader* allocation = findAttribute(mftBuffer, 0xA0, L"$I30");
+    if (!isFound && allocation && allocation->nonResident) {
+        int8_t clustersPerIndexBlock = driveInfo.bootSector.clustersPerIndexBlock;
+        uint32_t indexBlockSize = clustersPerIndexBlock > 0
+            ? clustersPerIndexBlock * driveInfo.bytesPerCluster
+            : 1u << (-1 * clustersPerIndexBlock);
+        if (indexBlockSize < FIXUP_STRIDE || indexBlockSize > INDEX_READ_BLOCK_SIZE) return false;
+
+        std::vector<ClusterExtent> indexRuns;
+        parseDataRuns(allocation, reinterpret_cast<const uint8_t*>(allocation), indexRuns);
+
+        std::vector<uint8_t> indexBlock(indexBlockSize);
+        uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+        for (const ClusterExtent& run : indexRuns) {
+            if (run.sparse) continue;
+            for (uint64_t offset = 0; !isFound && offset + indexBlockSize <= run.length * driveInfo.bytesPerCluster; offset += indexBlockSize) {
+                if (!sectorReader->readSectors(clusterToSector(run.start) + offset / bytesPerSector, indexBlockSize / bytesPerSector, indexBlock.data(), bytesPerSector)) continue;
+
+                const IndexBlockHeader* header = reinterpret_cast<const IndexBlockHeader*>(indexBlock.data());
+                if (header->signature != INDX_SIGNATURE || !applyFixups(indexBlock.data(), indexBlockSize)) continue;
+
+                size_t nodeOffset = offsetof(IndexBlockHeader, entriesOffset);
+                isFound = findIndexEntry(indexBlock.data() + nodeOffset, indexBlockSize - nodeOffset, journalName, journalReference);
+            }
+            if (isFound) break;
+        }
+    }
+    if (!isFound) return false;
+
+    // The journal data is the $J stream, $Max only holds its limits
+    if (!readMftRecordByNumber(journalReference & MFT_REFERENCE_MASK, mftBuffer)) return false;
+    applyFixups(mftBuffer.data(), driveInfo.mftRecordSize);
+    if (!isValidFileRecord(reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data()))) return false;
+
+    const AttributeHeader* stream = findAttribute(mftBuffer, 0x80, L"$J");
+    if (!stream || !stream->nonResident) return false;
+
+    streamSize = reinterpret_cast<const NonResidentAttributeHeader*>(stream)->realSize;
+    parseDataRuns(stream, reinterpret_cast<const uint8_t*>(stream), runs);
+    return !runs.empty();
+}
+
+void NTFSRecovery::parseUsnRecords(const uint8_t* data, size_t size, uint64_t cutoffTime, std::unordered_map<uint64_t, UsnDeletionEvent>& deletions) const {
+    size_t offset = 0;
+    while (offset + sizeof(UsnRecordHeader) <= size) {
+        const UsnRecordHeader* header = reinterpret_cast<const UsnRecordHeader*>(data + offset);
+
+        // Pages are zero-padded at the end, records never cross them
+        if (header->recordLength == 0 || header->recordLength % 8 != 0 || offset + header->recordLength > size) {
+            offset += 8;
+            continue;
+        }
+
+        uint64_t fileReference = 0;
+        uint64_t parentReference = 0;
+        uint64_t timeStamp = 0;
+        uint32_t reason = 0;
+        uint16_t nameLength = 0;
+        uint16_t nameOffset = 0;
+        if (header->majorVersion == 2 && header->recordLength >= sizeof(UsnRecordV2)) {
+            const UsnRecordV2* record = static_cast<const UsnRecordV2*>(header);
+            fileReference = record->fileReference;
+            parentReference = record->parentFileReference;
+            timeStamp = record->timeStamp;
+            reason = record->reason;
+            nameLength = record->fileNameLength;
+            nameOffset = record->fileNameOffset;
+        }
+        else if (header->majorVersion == 3 && header->recordLength >= sizeof(UsnRecordV3)) {
+            const UsnRecordV3* record = static_cast<const UsnRecordV3*>(header);
+            fileReference = record->fileReference;
+            parentReference = record->parentFileReference;
+            timeStamp = record->timeStamp;
+            reason = record->reason;
+            nameLength = record->fileNameLength;
+            nameOffset = record->fileNameOffset;
+        }
+
+        if ((reason & USN_REASON_FILE_DELETE) && timeStamp >= cutoffTime &&
+            nameLength > 0 && nameOffset + static_cast<uint32_t>(nameLength) <= header->recordLength) {
+            const uint16_t* name = reinterpret_cast<const uint16_t*>(data + offset + nameOffset);
+
+            // Later records of the same file win, the journal is in USN order
+            UsnDeletionEvent& deletion = deletions[fileReference];
+            deletion.fileReference = fileReference;
+            deletion.parentReference = parentReference;
+            deletion.timeStamp = timeStamp;
+            deletion.fileName.assign(name, name + nameLength / sizeof(uint16_t));
+        }
+        offset += header->recordLength;
+    }
+}
+
+// Read the parent directories of a file up to the root, so its path can be resolved without a full pass
+void NTFSRecovery::indexParentChain(uint64_t directoryRecord, std::vector<uint8_t>& mftBuffer) {
+    for (uint32_t depth = 0; depth < 256 && directoryRecord != ROOT_DIRECTORY_RECORD; depth++) {
+        if (directoryIndex.contains(directoryRecord)) return;
+        if (!readMftRecordByNumber(directoryRecord, mftBuffer)) return;
+
+        processMftRecord(mftBuffer, directoryRecord);
+        if (!directoryIndex.contains(directoryRecord)) return;
+        directoryRecord = directoryIndex.getParent(directoryRecord);
+    }
+}
+
+bool NTFSRecovery::scanUsnJournal() {
+    std::vector<ClusterExtent> runs;
+    uint64_t streamSize = 0;
+    if (!findUsnJournal(runs, streamSize)) {
+        std::cout << "[!] Change journal not found, falling back to a full MFT scan" << std::endl;
+        return false;
+    }
+
+    // FILETIME of now minus the requested number of days
+    auto sinceEpoch = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    uint64_t now = (static_cast<uint64_t>(sinceEpoch.count()) + 11644473600ULL) * 10000000ULL;
+    uint64_t cutoffTime = now - (std::min)(now, config.usnJournalDays * FILETIME_TICKS_PER_DAY);
+
+    std::cout << "[*] Reading change journal for deletions in the last " << config.usnJournalDays << " day(s)..." << std::endl;
+
+    // Most of $J is a sparse hole in front of the live records, only allocated runs are read
+    std::unordered_map<uint64_t, UsnDeletionEvent> deletions;
+    std::vector<uint8_t> block(USN_READ_BLOCK_SIZE);
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    uint64_t streamOffset = 0;
+
+    for (const ClusterExtent& run : runs) {
+        uint64_t runBytes = run.length * driveInfo.bytesPerCluster;
+        if (run.sparse) {
+            streamOffset += runBytes;
+            continue;
+        }
+
+        for (uint64_t runOffset = 0; runOffset < runBytes && streamOffset + runOffset < streamSize; runOffset += USN_READ_BLOCK_SIZE) {
+            uint32_t readSize = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(USN_READ_BLOCK_SIZE), runBytes - runOffset));
+            if (!sectorReader->readSectors(clusterToSector(run.start) + runOffset / bytesPerSector, readSize / bytesPerSector, block.data(), bytesPerSector)) {
+                continue;
+            }
+            size_t usable = static_cast<size_t>((std::min)(static_cast<uint64_t>(readSize), streamSize - streamOffset - runOffset));
+            parseUsnRecords(block.data(), usable, cutoffTime, deletions);
+        }
+        streamOffset += runBytes;
+    }
+
+    std::cout << "[*] " << deletions.size() << " deletion(s) in the journal, reading their MFT records..." << std::endl;
+
+    // Join every deletion with its record, in record order so the reads move forward over the MFT
+    std::vector<const UsnDeletionEvent*> ordered;
+    for (const auto& deletion : deletions) {
+        ordered.push_back(&deletion.second);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const UsnDeletionEvent* a, const UsnDeletionEvent* b) {
+        return (a->fileReference & MFT_REFERENCE_MASK) < (b->fileReference & MFT_REFERENCE_MASK);
+    });
+
+    directoryIndex.clear();
+    std::vector<uint8_t> mftBuffer;
+    std::vector<const UsnDeletionEvent*> reused;
+    for (const UsnDeletionEvent* deletion : ordered) {
+        uint64_t record = deletion->fileReference & MFT_REFERENCE_MASK;
+        if (!readMftRecordByNumber(record, mftBuffer)) continue;
+
+        // Freeing bumps the sequence number once, anything else means the record went to another file
+        const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+        uint16_t deletedSequence = static_cast<uint16_t>(deletion->fileReference >> 48);
+        bool isSameFile = isValidFileRecord(entry) && !(entry->flags & 0x0001) &&
+            (entry->sequenceNumber == deletedSequence || entry->sequenceNumber == static_cast<uint16_t>(deletedSequence + 1));
+        if (!isSameFile) {
+            reused.push_back(deletion);
+            continue;
+        }
+
+        processMftRecord(mftBuffer, record);
+        indexParentChain(deletion->parentReference & MFT_REFERENCE_MASK, mftBuffer);
+    }
+    completePendingFiles();
+    indexAllocations.clear(); // index slack needs the full pass
+
+    if (!reused.empty()) {
+        std::cout << "[!] " << reused.size() << " deleted file(s) have had their MFT record reused:" << std::endl;
+        for (const UsnDeletionEvent* deletion : reused) {
+            std::wcout << L"  [-] \"" << deletion->fileName << L"\" deleted " << formatFileTime(deletion->timeStamp)
+                << L" (record " << (deletion->fileReference & MFT_REFERENCE_MASK) << L")" << std::endl;
+        }
+    }
+    return true;
+}
+
+/* $LogFile */
+// Walk the log pages once, front to back. Only the record being reassembled across pages
+// and the per-record metadata found so far are kept in memory
+void NTFSRecovery::scanLogFile() {
+    std::vector<uint8_t> mftBuffer;
+    if (!readMftRecordByNumber(LOGFILE_RECORD_NUMBER, mftBuffer)) return;
+    applyFixups(mftBuffer.data(), driveInfo.mftRecordSize);
+    if (!isValidFileRecord(reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data()))) return;
+
+    const AttributeHeader* data = findAttribute(mftBuffer, 0x80, L"");
+    if (!data || !data->nonResident) return;
+
+    std::vector<ClusterExtent> runs;
+    parseDataRuns(data, reinterpret_cast<const uint8_t*>(data), runs);
+    uint64_t logSize = reinterpret_cast<const NonResidentAttributeHeader*>(data)->realSize;
+    if (runs.empty()) return;
+
+    std::cout << "[*] Scanning $LogFile (" << logSize << " bytes)..." << std::endl;
+
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    std::vector<uint8_t> block(USN_READ_BLOCK_SIZE);
+    std::vector<uint8_t> pending; // log record crossing into the next page
+    size_t pendingTotal = 0;
+    uint32_t logPageSize = 0;
+    uint64_t logOffset = 0;
+    std::unordered_map<uint64_t, LogFileCandidate> candidates;
+
+    for (const ClusterExtent& run : runs) {
+        uint64_t runBytes = run.length * driveInfo.bytesPerCluster;
+        if (run.sparse) {
+            logOffset += runBytes;
+            continue;
+        }
+
+        for (uint64_t runOffset = 0; runOffset < runBytes && logOffset + runOffset < logSize; runOffset += USN_READ_BLOCK_SIZE) {
+            uint32_t readSize = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(USN_READ_BLOCK_SIZE), runBytes - runOffset));
+            if (!sectorReader->readSectors(clusterToSector(run.start) + runOffset / bytesPerSector, readSize / bytesPerSector, block.data(), bytesPerSector)) {
+                pending.clear();
+                continue;
+            }
+
+            // The first restart page tells the page size, 4 KiB on every volume seen so far
+            if (logPageSize == 0) {
+                const LogRestartPageHeader* restart = reinterpret_cast<const LogRestartPageHeader*>(block.data());
+                if (restart->signature != RSTR_SIGNATURE || restart->logPageSize < FIXUP_STRIDE ||
+                    restart->logPageSize > USN_READ_BLOCK_SIZE || (restart->logPageSize & (restart->logPageSize - 1))) return;
+                logPageSize = restart->logPageSize;
+            }
+
+            for (uint32_t pageOffset = 0; pageOffset + logPageSize <= readSize; pageOffset += logPageSize) {
+                uint8_t* page = block.data() + pageOffset;
+                const LogRecordPageHeader* header = reinterpret_cast<const LogRecordPageHeader*>(page);
+                if (header->signature != RCRD_SIGNATURE || !applyFixups(page, logPageSize)) {
+                    pending.clear();
+                    continue;
+                }
+
+                size_t dataStart = (header->updateSequenceOffset + header->updateSequenceSize * sizeof(uint16_t) + 7) & ~static_cast<size_t>(7);
+                size_t dataEnd = (std::min)(static_cast<size_t>(logPageSize), static_cast<size_t>(header->nextRecordOffset) + sizeof(LogRecordHeader));
+                size_t offset = dataStart;
+
+                // Finish a record that started on the previous page
+                if (!pending.empty()) {
+                    size_t take = (std::min)(pendingTotal - pending.size(), logPageSize - dataStart);
+                    pending.insert(pending.end(), page + dataStart, page + dataStart + take);
+                    if (pending.size() < pendingTotal) continue;
+
+                    processLogRecord(pending.data() + sizeof(LogRecordHeader), pendingTotal - sizeof(LogRecordHeader), candidates);
+                    pending.clear();
+                    offset = (dataStart + take + 7) & ~static_cast<size_t>(7);
+                }
+
+                while (offset + sizeof(LogRecordHeader) <= dataEnd) {
+                    const LogRecordHeader* record = reinterpret_cast<const LogRecordHeader*>(page + offset);
+                    if (record->thisLsn == 0 || (record->recordType != 1 && record->recordType != 2)) break;
+
+                    size_t total = sizeof(LogRecordHeader) + record->clientDataLength;
+                    if (offset + total > logPageSize) {
+                        // Buffer the start of a record that continues on the next page
+                        if ((record->flags & 0x0001) && total <= MAX_LOG_RECORD_SIZE) {
+                            pending.assign(page + offset, page + logPageSize);
+                            pendingTotal = total;
+                        }
+                        break;
+                    }
+
+                    if (record->recordType == 1) {
+                        processLogRecord(page + offset + sizeof(LogRecordHeader), record->clientDataLength, candidates);
+                    }
+                    offset = (offset + total + 7) & ~static_cast<size_t>(7);
+                }
+            }
+        }
+        logOffset += runBytes;
+    }
+
+    addLogFileCandidates(candidates);
+}
+
+void NTFSRecovery::processLogRecord(const uint8_t* clientData, size_t clientDataLength, std::unordered_map<uint64_t, LogFileCandidate>& candidates) const {
+    if (clientDataLength < sizeof(NTFSLogRecordHeader)) return;
+    const NTFSLogRecordHeader* header = reinterpret_cast<const NTFSLogRecordHeader*>(clientData);
+
+    // MFT record the operation was applied to, only meaningful for file record operations
+    uint64_t targetRecord = (header->targetVcn * driveInfo.bytesPerCluster + header->clusterBlockOffset * 512ULL) / driveInfo.mftRecordSize;
+
+    auto image = [&](uint16_t imageOffset, uint16_t imageLength, const uint8_t*& start, size_t& length) {
+        if (imageLength == 0 || imageOffset + static_cast<size_t>(imageLength) > clientDataLength) return false;
+        start = clientData + imageOffset;
+        length = imageLength;
+        return true;
+    };
+
+    const uint8_t* start = nullptr;
+    size_t length = 0;
+    struct Operation { uint16_t code; uint16_t offset; uint16_t length; };
+    const Operation operations[2] = {
+        { header->redoOperation, header->redoOffset, header->redoLength },
+        { header->undoOperation, header->undoOffset, header->undoLength }
+    };
+
+    for (const Operation& operation : operations) {
+        if (!image(operation.offset, operation.length, start, length)) continue;
+
+        switch (operation.code) {
+        case 0x02: { // InitializeFileRecordSegment, a whole file record image
+            if (length < sizeof(MFTEntryHeader) || header->recordOffset != 0) break;
+            const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(start);
+            if (!isValidFileRecord(entry) || (entry->baseFileRecord & MFT_REFERENCE_MASK) != 0) break;
+
+            size_t attributeOffset = entry->firstAttributeOffset;
+            while (attributeOffset + sizeof(AttributeHeader) <= length) {
+                const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(start + attributeOffset);
+                if (attr->type == 0xFFFFFFFF || attr->length == 0 || attributeOffset + attr->length > length) break;
+                applyLoggedAttribute(start + attributeOffset, attr->length, candidates[targetRecord]);
+                attributeOffset += attr->length;
+            }
+            break;
+        }
+        case 0x05:   // CreateAttribute (redo) and DeleteAttribute (undo) carry the attribute image
+        case 0x06:
+            if (header->attributeOffset == 0) break;
+            applyLoggedAttribute(start, length, candidates[targetRecord]);
+            break;
+
+        case 0x0C:   // Add/DeleteIndexEntryRoot/Allocation carry an index entry with a $FILE_NAME key
+        case 0x0D:
+        case 0x0E:
+        case 0x0F: {
+            if (length < sizeof(IndexEntryHeader) + offsetof(FileNameAttribute, name)) break;
+            const IndexEntryHeader* entry = reinterpret_cast<const IndexEntryHeader*>(start);
+            const FileNameAttribute* key = reinterpret_cast<const FileNameAttribute*>(start + sizeof(IndexEntryHeader));
+            size_t nameEnd = sizeof(IndexEntryHeader) + offsetof(FileNameAttribute, name) + key->nameLength * sizeof(uint16_t);
+            if (key->nameLength == 0 || key->nameType == 2 || nameEnd > length || entry->keyLength + sizeof(IndexEntryHeader) > length) break;
+
+            LogFileCandidate& candidate = candidates[entry->fileReference & MFT_REFERENCE_MASK];
+            if (candidate.fileName.empty()) {
+                const uint16_t* name = reinterpret_cast<const uint16_t*>(start + sizeof(IndexEntryHeader) + offsetof(FileNameAttribute, name));
+                candidate.fileName.assign(name, name + key->nameLength);
+                candidate.parentReference = key->parentDirectory;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void NTFSRecovery::applyLoggedAttribute(const uint8_t* image, size_t imageLength, LogFileCandidate& candidate) const {
+    if (imageLength < sizeof(ResidentAttributeHeader)) return;
+    const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(image);
+    if (attr->length > imageLength) return;
+
+    if (attr->type == 0x30 && !attr->nonResident) {
+        const ResidentAttributeHeader* resident = reinterpret_cast<const ResidentAttributeHeader*>(image);
+        size_t nameOffset = resident->contentOffset + offsetof(FileNameAttribute, name);
+        if (nameOffset > attr->length) return;
+
+        const FileNameAttribute* fnAttr = reinterpret_cast<const FileNameAttribute*>(image + resident->contentOffset);
+        if (fnAttr->nameLength == 0 || nameOffset + fnAttr->nameLength * sizeof(uint16_t) > attr->length) return;
+        if (fnAttr->nameType == 2 && !candidate.fileName.empty()) return;
+
+        const uint16_t* name = reinterpret_cast<const uint16_t*>(image + nameOffset);
+        candidate.fileName.assign(name, name + fnAttr->nameLength);
+        candidate.parentReference = fnAttr->parentDirectory;
+    }
+    else if (attr->type == 0x80 && attr->nonResident && attr->nameLength == 0 && imageLength >= sizeof(NonResidentAttributeHeader)) {
+        const NonResidentAttributeHeader* nonResident = reinterpret_cast<const NonResidentAttributeHeader*>(image);
+        if (nonResident->startingVCN != 0 || nonResident->dataRunOffset >= attr->length) return;
+
+        // The latest full run list in the log wins
+        std::vector<ClusterExtent> runs;
+        parseDataRuns(attr, image, runs);
+        if (!runs.empty()) {
+            candidate.runs = std::move(runs);
+            candidate.fileSize = nonResident->realSize;
+            candidate.compressionUnit = (attr->flags & 0x0001) ? static_cast<uint8_t>(nonResident->compressionUnit) : 0;
+        }
+    }
+}
+
+void NTFSRecovery::addLogFileCandidates(std::unordered_map<uint64_t, LogFileCandidate>& candidates) {
+    // Files the MFT pass already found need no second copy
+    std::unordered_map<uint64_t, std::wstring> knownFiles;
+    for (const NTFSFileInfo& file : recoveryList) {
+        if (file.streamName.empty()) knownFiles[file.recordNumber] = file.fileName;
+    }
+
+    uint32_t added = 0;
+    for (auto& item : candidates) {
+        LogFileCandidate& candidate = item.second;
+        if (candidate.fileName.empty() || candidate.runs.empty() || candidate.fileSize == 0) continue;
+
+        auto known = knownFiles.find(item.first);
+        if (known != knownFiles.end() && known->second == candidate.fileName) continue;
+
+        NTFSFileInfo fileInfo = {};
+        fileInfo.fileName = candidate.fileName;
+        fileInfo.fileId = fileId;
+        fileInfo.recordNumber = item.first;
+        fileInfo.fileSize = candidate.fileSize;
+        fileInfo.runs = std::move(candidate.runs);
+        fileInfo.compressionUnit = candidate.compressionUnit;
+        fileInfo.nonResident = true;
+        fileInfo.isCarved = true;
+        for (const ClusterExtent& run : fileInfo.runs) {
+            if (!run.sparse) {
+                fileInfo.cluster = run.start;
+                break;
+            }
+        }
+
+        if (validateFileInfo(fileInfo)) {
+            addToRecoveryList(fileInfo);
+            this->fileId++;
+            added++;
+        }
+    }
+    std::cout << "[+] Rebuilt " << added << " file(s) from $LogFile records" << std::endl;
+}
+
+void NTFSRecovery::processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSFileInfo& fileInfo, std::vector<NTFSFileInfo>& namedStreams, uint32_t attributeOffset, bool& hasFileName, bool& hasData, bool isDeleted) {
     while (attributeOffset < driveInfo.mftRecordSize) {
         const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(
             mftBuffer.data() + attributeOffset);
@@ -258,12 +1145,27 @@ void NTFSRecovery::processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSF
         // Process different attribute types
         switch (attr->type) {
         case 0x30:  // $FILE_NAME
-            processFileNameAttribute(attr, mftBuffer.data() + attributeOffset, isDeleted, fileInfo);
+            processFileNameAttribute(reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data()), attr, mftBuffer.data() + attributeOffset, isDeleted, fileInfo);
             hasFileName = true;
             break;
 
-        case 0x80:  // $DATA
-            processDataAttribute(attr, mftBuffer.data() + attributeOffset, isDeleted, fileInfo);
+        case 0x20:  // $ATTRIBUTE_LIST
+            if (isDeleted) processAttributeList(attr, mftBuffer.data() + attributeOffset, fileInfo);
+            break;
+
+        case 0xA0:  // $INDEX_ALLOCATION, only read for its slack
+            if (config.deepScan && attr->nonResident && !fileInfo.isCarved) {
+                queueIndexAllocation(attr, mftBuffer.data() + attributeOffset, fileInfo.recordNumber);
+            }
+            break;
+
+        case 0x80:  // $DATA, every named stream is kept apart from the main one
+            if (attr->nameLength == 0) {
+                processDataAttribute(attr, mftBuffer.data() + attributeOffset, isDeleted, fileInfo);
+            }
+            else if (isDeleted) {
+                processDataAttribute(attr, mftBuffer.data() + attributeOffset, isDeleted, getNamedStream(attr, mftBuffer.data() + attributeOffset, namedStreams));
+            }
             hasData = true;
             break;
         }
@@ -272,13 +1174,221 @@ void NTFSRecovery::processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSF
     }
 }
 
-void NTFSRecovery::processFileNameAttribute(const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo) {
+NTFSFileInfo& NTFSRecovery::getNamedStream(const AttributeHeader* attr, const uint8_t* attrData, std::vector<NTFSFileInfo>& namedStreams) const {
+    std::wstring streamName;
+    if (attr->nameOffset + attr->nameLength * sizeof(uint16_t) <= attr->length) {
+        const uint16_t* name = reinterpret_cast<const uint16_t*>(attrData + attr->nameOffset);
+        streamName.assign(name, name + attr->nameLength);
+    }
+
+    // Pieces of the same stream in one record belong together
+    for (NTFSFileInfo& stream : namedStreams) {
+        if (stream.streamName == streamName) return stream;
+    }
+    namedStreams.push_back({});
+    namedStreams.back().streamName = streamName;
+    return namedStreams.back();
+}
+
+void NTFSRecovery::addNamedStreams(const NTFSFileInfo& fileInfo, std::vector<NTFSFileInfo>& namedStreams) {
+    for (NTFSFileInfo& stream : namedStreams) {
+        // Empty streams are common (e.g. markers) and have nothing to recover
+        if (stream.fileSize == 0) continue;
+
+        stream.fileName = fileInfo.fileName;
+        stream.recordNumber = fileInfo.recordNumber;
+        stream.isCarved = fileInfo.isCarved;
+        stream.fileId = fileId;
+        if (validateFileInfo(stream)) {
+            addToRecoveryList(stream);
+            this->fileId++;
+        }
+    }
+}
+
+void NTFSRecovery::processExtensionRecord(const std::vector<uint8_t>& mftBuffer, uint64_t recordNumber, bool isDeleted) {
+    const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+    uint64_t baseRecord = entry->baseFileRecord & MFT_REFERENCE_MASK;
+
+    NTFSFileInfo extensionInfo = {};
+    extensionInfo.recordNumber = recordNumber;
+
+    uint32_t attributeOffset = entry->firstAttributeOffset;
+    while (attributeOffset + sizeof(AttributeHeader) <= driveInfo.mftRecordSize) {
+        const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(mftBuffer.data() + attributeOffset);
+        if (attr->type == 0xFFFFFFFF) break;
+        if (attr->length == 0 || attributeOffset + attr->length > driveInfo.mftRecordSize) break;
+
+        const uint8_t* attrData = mftBuffer.data() + attributeOffset;
+        if (attr->type == 0x30) {
+            processFileNameAttribute(entry, attr, attrData, isDeleted, extensionInfo);
+        }
+        else if (attr->type == 0x80 && attr->nonResident && attr->nameLength == 0 && isDeleted) {
+            const NonResidentAttributeHeader* nonResident = reinterpret_cast<const NonResidentAttributeHeader*>(attrData);
+
+            DataAttributePiece piece = {};
+            piece.record = recordNumber;
+            piece.sequence = entry->sequenceNumber;
+            piece.startingVCN = nonResident->startingVCN;
+            piece.realSize = nonResident->realSize;
+            piece.compressionUnit = (attr->flags & 0x0001) ? static_cast<uint8_t>(nonResident->compressionUnit) : 0;
+            parseDataRuns(attr, attrData, piece.runs);
+            if (!piece.runs.empty()) {
+                extensionPieces[baseRecord].push_back(std::move(piece));
+            }
+        }
+        attributeOffset += attr->length;
+    }
+}
+
+void NTFSRecovery::processAttributeList(const AttributeHeader* attr, const uint8_t* attrData, NTFSFileInfo& fileInfo) {
+    fileInfo.hasAttributeList = true;
+
+    // Small lists are resident, very fragmented files push the list itself out to clusters
+    std::vector<uint8_t> list;
+    if (!attr->nonResident) {
+        const ResidentAttributeHeader* resident = reinterpret_cast<const ResidentAttributeHeader*>(attrData);
+        if (resident->contentOffset + static_cast<uint64_t>(resident->contentLength) > attr->length) return;
+        list.assign(attrData + resident->contentOffset, attrData + resident->contentOffset + resident->contentLength);
+    }
+    else {
+        const NonResidentAttributeHeader* nonResident = reinterpret_cast<const NonResidentAttributeHeader*>(attrData);
+        if (nonResident->realSize > MAX_ATTRIBUTE_LIST_SIZE) return;
+
+        std::vector<ClusterExtent> runs;
+        parseDataRuns(attr, attrData, runs);
+
+        std::vector<uint8_t> clusterBuffer(driveInfo.bytesPerCluster);
+        for (const ClusterExtent& run : runs) {
+            for (uint64_t i = 0; i < run.length && list.size() < nonResident->realSize; i++) {
+                if (run.sparse) {
+                    std::fill(clusterBuffer.begin(), clusterBuffer.end(), 0);
+                }
+                else if (!sectorReader->readSectors(clusterToSector(run.start + i), driveInfo.bootSector.sectorsPerCluster,
+                    clusterBuffer.data(), driveInfo.bootSector.bytesPerSector)) {
+                    return;
+                }
+                list.insert(list.end(), clusterBuffer.begin(), clusterBuffer.end());
+            }
+        }
+        if (list.size() < nonResident->realSize) return;
+        list.resize(static_cast<size_t>(nonResident->realSize));
+    }
+
+    // Only the unnamed $DATA pieces matter for recovery
+    size_t offset = 0;
+    while (offset + sizeof(AttributeListEntry) <= list.size()) {
+        const AttributeListEntry* listEntry = reinterpret_cast<const AttributeListEntry*>(list.data() + offset);
+        if (listEntry->length < sizeof(AttributeListEntry) || offset + listEntry->length > list.size()) break;
+
+        if (listEntry->type == 0x80 && listEntry->nameLength == 0) {
+            fileInfo.dataSegments.push_back({ listEntry->startingVCN, listEntry->segmentReference });
+        }
+        offset += listEntry->length;
+    }
+}
+
+bool NTFSRecovery::isListedPiece(const NTFSFileInfo& fileInfo, const DataAttributePiece& piece) const {
+    // Without a readable list every piece pointing back at the base record is taken
+    if (fileInfo.dataSegments.empty()) return true;
+
+    for (const AttributeListSegment& segment : fileInfo.dataSegments) {
+        if ((segment.segmentReference & MFT_REFERENCE_MASK) != piece.record || segment.startingVCN != piece.startingVCN) continue;
+
+        // Freeing a record bumps its sequence number, a larger difference means it was reused
+        uint16_t listedSequence = static_cast<uint16_t>(segment.segmentReference >> 48);
+        if (listedSequence == 0 || listedSequence == piece.sequence || static_cast<uint16_t>(listedSequence + 1) == piece.sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NTFSRecovery::joinExtensionRuns(NTFSFileInfo& fileInfo) {
+    auto found = extensionPieces.find(fileInfo.recordNumber);
+    if (found == extensionPieces.end()) return;
+
+    std::vector<const DataAttributePiece*> pieces;
+    for (const DataAttributePiece& piece : found->second) {
+        if (isListedPiece(fileInfo, piece)) pieces.push_back(&piece);
+    }
+    std::sort(pieces.begin(), pieces.end(), [](const DataAttributePiece* a, const DataAttributePiece* b) {
+        return a->startingVCN < b->startingVCN;
+    });
+
+    // Runs held by the base record start at VCN 0
+    uint64_t nextVCN = 0;
+    for (const ClusterExtent& run : fileInfo.runs) {
+        nextVCN += run.length;
+    }
+
+    for (const DataAttributePiece* piece : pieces) {
+        if (piece->startingVCN < nextVCN) continue; // already covered, stale duplicate
+        if (piece->startingVCN == 0 && fileInfo.fileSize == 0) {
+            fileInfo.fileSize = piece->realSize;
+            fileInfo.compressionUnit = piece->compressionUnit;
+        }
+
+        // A missing piece keeps its place as a sparse run so later data stays at the right offset
+        if (piece->startingVCN > nextVCN) {
+            fileInfo.runs.push_back({ 0, piece->startingVCN - nextVCN, true });
+        }
+        for (const ClusterExtent& run : piece->runs) {
+            fileInfo.runs.push_back(run);
+            if (!run.sparse && fileInfo.cluster == 0) {
+                fileInfo.cluster = run.start;
+            }
+        }
+        nextVCN = piece->startingVCN;
+        for (const ClusterExtent& run : piece->runs) {
+            nextVCN += run.length;
+        }
+        fileInfo.nonResident = true;
+    }
+}
+
+// Files with an $ATTRIBUTE_LIST are joined with their extension records after the whole MFT was read
+void NTFSRecovery::completePendingFiles() {
+    for (NTFSFileInfo& fileInfo : pendingFiles) {
+        joinExtensionRuns(fileInfo);
+
+        // Long or many names may have been moved to an extension record as well
+        if (fileInfo.fileName.empty()) {
+            fileInfo.fileName = directoryIndex.getName(fileInfo.recordNumber);
+        }
+        fileInfo.fileId = fileId;
+
+        if (validateFileInfo(fileInfo)) {
+            addToRecoveryList(fileInfo);
+            this->fileId++;
+        }
+    }
+    pendingFiles.clear();
+    pendingFiles.shrink_to_fit();
+    extensionPieces.clear();
+}
+
+void NTFSRecovery::processFileNameAttribute(const MFTEntryHeader* entry, const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo) {
     if (!attr->nonResident) {  // File name is always resident
         const ResidentAttributeHeader* resAttr = reinterpret_cast<const ResidentAttributeHeader*>(attrData);
+        if (resAttr->contentOffset + offsetof(FileNameAttribute, name) > attr->length) return;
+
         const uint8_t* filenameData = attrData + resAttr->contentOffset;
         const FileNameAttribute* fnAttr = reinterpret_cast<const FileNameAttribute*>(filenameData);
 
-        if (fnAttr->nameLength > 255) return;
+        if (resAttr->contentOffset + offsetof(FileNameAttribute, name) + fnAttr->nameLength * sizeof(wchar_t) > attr->length) return;
+
+        // Extension records carry the names of their base record. A torn record can hold any
+        // base reference, and the index grows to whatever record number it is given
+        uint64_t baseRecord = entry->baseFileRecord & MFT_REFERENCE_MASK;
+        uint64_t indexRecord = baseRecord ? baseRecord : fileInfo.recordNumber;
+        if (!fileInfo.isCarved && indexRecord < driveInfo.totalMftRecords) {
+            directoryIndex.add(indexRecord, entry->sequenceNumber, fnAttr->parentDirectory,
+                fnAttr->name, fnAttr->nameLength, fnAttr->nameType, !isDeleted, (entry->flags & 0x0002) != 0);
+        }
+
+        // The DOS 8.3 alias never replaces the long name
+        if (fnAttr->nameType == 2 && !fileInfo.fileName.empty()) return;
         std::wstring wfilename(fnAttr->name, fnAttr->nameLength);
 
         if (isDeleted) {
@@ -288,53 +1398,74 @@ void NTFSRecovery::processFileNameAttribute(const AttributeHeader* attr, const u
     }
 }
 
-void NTFSRecovery::processDataAttribute(const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo) {
-    if (attr->nonResident) {
-        const NonResidentAttributeHeader* nonResident =
-            reinterpret_cast<const NonResidentAttributeHeader*>(attrData);
+void NTFSRecovery::parseDataRuns(const AttributeHeader* attr, const uint8_t* attrData, std::vector<ClusterExtent>& runs) const {
+    const NonResidentAttributeHeader* nonResident =
+        reinterpret_cast<const NonResidentAttributeHeader*>(attrData);
 
-        fileInfo.fileSize = nonResident->realSize;
+    const uint8_t* runList = attrData + nonResident->dataRunOffset;
+    const uint8_t* runListEnd = attrData + attr->length;
+    uint64_t currentLCN = 0;
 
-        const uint8_t* runList = attrData + nonResident->dataRunOffset;
-        uint64_t currentLCN = 0;
+    while (runList < runListEnd && *runList) {
+        uint8_t header = *runList++;
+        uint8_t lengthSize = header & 0x0F;
+        uint8_t offsetSize = (header >> 4) & 0x0F;
 
-        while (*runList) {
-            uint8_t header = *runList++;
-            uint8_t lengthSize = header & 0x0F;
-            uint8_t offsetSize = (header >> 4) & 0x0F;
+        if (lengthSize == 0 || lengthSize > 8 || offsetSize > 8 || runList + lengthSize + offsetSize > runListEnd) break;
 
-            if (lengthSize == 0) break;
+        // Read run length
+        uint64_t runLength = 0;
+        for (int i = 0; i < lengthSize; i++) {
+            runLength |= static_cast<uint64_t>(*runList++) << (i * 8);
+        }
 
-            // Read run length
-            uint64_t runLength = 0;
-            for (int i = 0; i < lengthSize; i++) {
-                runLength |= static_cast<uint64_t>(*runList++) << (i * 8);
+        // Read run offset (can be negative), a run without offset is sparse
+        int64_t runOffset = 0;
+        bool isSparse = offsetSize == 0;
+        if (!isSparse) {
+            for (int i = 0; i < offsetSize; i++) {
+                runOffset |= static_cast<uint64_t>(*runList++) << (i * 8);
             }
 
-            // Read run offset (can be negative)
-            int64_t runOffset = 0;
-            if (offsetSize > 0) {
-                for (int i = 0; i < offsetSize; i++) {
-                    runOffset |= static_cast<uint64_t>(*runList++) << (i * 8);
-                }
-
-                // Sign extend if the highest bit is set
-                if (runOffset & (1ULL << ((offsetSize * 8) - 1))) {
-                    runOffset |= ~((1LL << (offsetSize * 8)) - 1); // Apply sign extension
-                }
+            // Sign extend if the highest bit is set
+            if (offsetSize < 8 && (runOffset & (1ULL << ((offsetSize * 8) - 1)))) {
+                runOffset |= ~((1LL << (offsetSize * 8)) - 1); // Apply sign extension
             }
+        }
 
-            currentLCN += runOffset;
-            if (currentLCN > driveInfo.bootSector.totalSectors / driveInfo.bootSector.sectorsPerCluster) {
-                break;
-            }
+        currentLCN += runOffset;
+        if (!isSparse && currentLCN + runLength > driveInfo.totalClusters) {
+            break;
+        }
+
+        runs.push_back({ isSparse ? 0 : currentLCN, runLength, isSparse });
+    }
+}
+
+void NTFSRecovery::processDataAttribute(const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo) {
+    if (attr->nonResident) {
+        const NonResidentAttributeHeader* nonResident =
+            reinterpret_cast<const NonResidentAttributeHeader*>(attrData);
 
-            if (isDeleted) {
-                fileInfo.cluster = currentLCN;
-                fileInfo.runLength = runLength;
-                fileInfo.nonResident = true;
+        // Extension pieces of the same attribute continue the run list where the previous piece ended
+        if (nonResident->startingVCN == 0) {
+            fileInfo.fileSize = nonResident->realSize;
+            fileInfo.cluster = 0;
+            fileInfo.runs.clear();
+            // Flag 0x0001: compressed with LZNT1
+            fileInfo.compressionUnit = (attr->flags & 0x0001) ? static_cast<uint8_t>(nonResident->compressionUnit) : 0;
+        }
+
+        if (!isDeleted) return;
+
+        size_t firstNewRun = fileInfo.runs.size();
+        parseDataRuns(attr, attrData, fileInfo.runs);
+        for (size_t i = firstNewRun; i < fileInfo.runs.size(); i++) {
+            if (!fileInfo.runs[i].sparse && fileInfo.cluster == 0) {
+                fileInfo.cluster = fileInfo.runs[i].start;
             }
         }
+        fileInfo.nonResident = true;
     }
     else {
         const ResidentAttributeHeader* resident = reinterpret_cast<const ResidentAttributeHeader*>(attrData);
@@ -351,7 +1482,27 @@ void NTFSRecovery::processDataAttribute(const AttributeHeader* attr, const uint8
 
 
 void NTFSRecovery::addToRecoveryList(const NTFSFileInfo& fileInfo) {
+    // The list is still needed while streaming, the log and the $LogFile pass check against it
     recoveryList.push_back(fileInfo);
+    if (streamQueue) streamQueue->push(fileInfo);
+}
+
+std::wstring NTFSRecovery::getRelativePath(const NTFSFileInfo& fileInfo) {
+    static const std::wstring carvedPath = CARVED_FOLDER;
+    const std::wstring& parentPath = fileInfo.isCarved ? carvedPath : directoryIndex.getParentPath(fileInfo.recordNumber);
+    std::wstring name = fileInfo.streamName.empty() ? fileInfo.fileName : fileInfo.fileName + L":" + fileInfo.streamName;
+    return parentPath.empty() ? name : parentPath + L"\\" + name;
+}
+
+std::wstring NTFSRecovery::getOutputName(const NTFSFileInfo& fileInfo) const {
+    if (fileInfo.streamName.empty()) return fileInfo.fileName;
+
+    // ':' is not valid in output file names, and the stream name may carry other reserved characters
+    std::wstring streamName = fileInfo.streamName;
+    for (wchar_t& c : streamName) {
+        if (c < 32 || wcschr(L"<>:\"/\\|?*", c)) c = L'_';
+    }
+    return fileInfo.fileName + L"_" + streamName;
 }
 
 
@@ -405,10 +1556,67 @@ std::vector<NTFSFileInfo> NTFSRecovery::selectFilesToRecover(const std::vector<N
 }
 
 void NTFSRecovery::runLogicalDriveRecovery() {
+    // Asked before the streaming recovery thread is started, so declining leaves nothing running
+    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
+        std::cout << "Exitting..." << std::endl;
+        exit(1);
+    }
+    if (config.stream && (config.recover || config.analyze)) {
+        runStreamingRecovery();
+        return;
+    }
     scanForDeletedFiles();
     recoverPartition();
 }
 
+// Recover files while the scan is still running. addToRecoveryList feeds a bounded queue and a
+// recovery thread takes the files off it in batches, so every file found is selected
+void NTFSRecovery::runStreamingRecovery() {
+    // The bitmap is only read, so it can be loaded before the scanner and the workers start
+    if (config.analyze && !loadVolumeBitmap()) {
+        std::cout << "[!] Failed to load $Bitmap, clusters reused by live files will not be detected" << std::endl;
+    }
+    workerClusters.assign(scheduler.getWorkerCount(), ClusterBitset(driveInfo.totalClusters));
+
+    streamQueue = std::make_unique<BoundedQueue<NTFSFileInfo>>(RecoveryScheduler::STREAM_QUEUE_CAPACITY);
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results;
+    if (config.analyze) {
+        std::cout << "[!] Streaming: overlaps are only checked against files found so far" << std::endl;
+    }
+
+    auto recovering = std::async(std::launch::async, [this, &results]() {
+        std::vector<NTFSFileInfo> batch;
+        try {
+            while (streamQueue->popBatch(batch, RecoveryScheduler::STREAM_BATCH_FILES)) {
+                if (config.analyze) buildOwnershipIndex(batch);
+                std::vector<RecoveryStatus> batchResults = recoverFiles(batch);
+                results.insert(results.end(), batchResults.begin(), batchResults.end());
+            }
+        }
+        catch (...) {
+            // Don't leave the scanner blocked on a full queue
+            streamQueue->close();
+            throw;
+        }
+    });
+
+    try {
+        scanForDeletedFiles();
+    }
+    catch (...) {
+        streamQueue->close();
+        recovering.wait();
+        throw;
+    }
+    streamQueue->close();
+    recovering.get();
+    streamQueue.reset();
+    archive.reset();
+
+    if (config.recover) RecoveryScheduler::showSummary(results);
+}
+
 void NTFSRecovery::recoverPartition() {
     utils.printHeader("File Recovery and Analysis:");
     if (recoveryList.empty()) {
@@ -427,115 +1635,394 @@ void NTFSRecovery::recoverPartition() {
         selectedDeletedFiles = recoveryList;
     }
 
-    for (const auto& file : selectedDeletedFiles) {
-        processFileForRecovery(file);
+    if (config.analyze) {
+        if (!loadVolumeBitmap()) {
+            std::cout << "[!] Failed to load $Bitmap, clusters reused by live files will not be detected" << std::endl;
+        }
+        buildOwnershipIndex(recoveryList);
     }
+
+    workerClusters.assign(scheduler.getWorkerCount(), ClusterBitset(driveInfo.totalClusters));
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results = recoverFiles(selectedDeletedFiles);
+    archive.reset();
+    if (config.recover) RecoveryScheduler::showSummary(results);
 }
 
-void NTFSRecovery::processFileForRecovery(const NTFSFileInfo& fileInfo) {
-    bool isExtensionPredicted = false;
+// Resident and compressed files are recovered by the workers, plain run lists are read afterwards in disk order
+std::vector<RecoveryStatus> NTFSRecovery::recoverFiles(const std::vector<NTFSFileInfo>& files) {
+    // Output folders and names are claimed up front, one file after another, so two jobs never pick the same name
+    std::vector<const NTFSFileInfo*> jobs;
+    std::vector<fs::path> outputPaths;
+    for (const auto& file : files) {
+        // Skip files that don't match the target cluster and size (if specified)
+        if (file.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (file.cluster != config.targetCluster || file.fileSize != config.targetFileSize))) {
+            continue;
+        }
 
-    // Skip files that don't match the target cluster and size (if specified)
-    if (fileInfo.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (fileInfo.cluster != config.targetCluster || fileInfo.fileSize != config.targetFileSize))) {
-        return;
+        // Mirror the original directory tree under the output folder. While streaming the tree
+        // is still being built by the scanner, so only carved files get a folder of their own
+        fs::path outputFolder = config.outputFolder;
+        if (file.isCarved) outputFolder /= CARVED_FOLDER;
+        else if (!config.stream) outputFolder /= directoryIndex.getParentPath(file.recordNumber);
+        if (config.recover && !archive) {
+            std::error_code error;
+            fs::create_directories(outputFolder, error);
+            if (error) outputFolder = config.outputFolder;
+        }
+        jobs.push_back(&file);
+        outputPaths.push_back(utils.claimOutputPath(getOutputName(file), outputFolder.wstring()));
+    }
+
+    std::vector<RecoveryStatus> results = scheduler.run(jobs.size(), [&](size_t index, uint32_t worker, std::wostream& out) {
+        return processFileForRecovery(*jobs[index], outputPaths[index], workerClusters[worker], out);
+    });
+    if (config.recover) {
+        recoverInDiskOrder(jobs, outputPaths, results);
+    }
+    return results;
+}
+
+// Read the allocation bitmap once, every run of every candidate is checked against this copy
+bool NTFSRecovery::loadVolumeBitmap() {
+    std::cout << "[*] Loading volume bitmap..." << std::endl;
+    volumeBitmap.clear();
+
+    uint32_t sectorsPerMftRecord = getSectorsPerMftRecord();
+    uint64_t recordSector = clusterToSector(driveInfo.bootSector.mftCluster) + BITMAP_RECORD_NUMBER * sectorsPerMftRecord;
+    if (!isValidSector(recordSector)) return false;
+
+    std::vector<uint8_t> mftBuffer(driveInfo.mftRecordSize);
+    if (!readMftRecord(mftBuffer, sectorsPerMftRecord, recordSector)) return false;
+
+    const MFTEntryHeader* entry = reinterpret_cast<const MFTEntryHeader*>(mftBuffer.data());
+    if (!isValidFileRecord(entry)) return false;
+
+    // Find the unnamed non-resident $DATA attribute
+    std::vector<ClusterExtent> runs;
+    uint64_t bitmapSize = 0;
+    uint32_t attributeOffset = entry->firstAttributeOffset;
+    while (attributeOffset + sizeof(AttributeHeader) <= driveInfo.mftRecordSize) {
+        const AttributeHeader* attr = reinterpret_cast<const AttributeHeader*>(mftBuffer.data() + attributeOffset);
+        if (attr->type == 0xFFFFFFFF) break;
+        if (attr->length == 0 || attributeOffset + attr->length > driveInfo.mftRecordSize) break;
+
+        if (attr->type == 0x80 && attr->nonResident && attr->nameLength == 0) {
+            const uint8_t* attrData = mftBuffer.data() + attributeOffset;
+            bitmapSize = reinterpret_cast<const NonResidentAttributeHeader*>(attrData)->realSize;
+            parseDataRuns(attr, attrData, runs);
+            break;
+        }
+        attributeOffset += attr->length;
+    }
+    if (runs.empty() || bitmapSize < (driveInfo.totalClusters + 7) / 8) return false;
+
+    // Read the runs in large blocks, sparse runs stay zero
+    std::vector<uint8_t> bitmap(static_cast<size_t>(bitmapSize), 0);
+    std::vector<uint8_t> block(BITMAP_READ_BLOCK_SIZE);
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    uint64_t bytesDone = 0;
+
+    for (const ClusterExtent& run : runs) {
+        uint64_t runBytes = run.length * driveInfo.bytesPerCluster;
+        if (run.sparse) {
+            bytesDone += runBytes;
+            continue;
+        }
+
+        uint64_t sector = clusterToSector(run.start);
+        uint64_t runOffset = 0;
+        while (runOffset < runBytes && bytesDone < bitmapSize) {
+            uint32_t chunk = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(BITMAP_READ_BLOCK_SIZE), runBytes - runOffset));
+            if (!sectorReader->readSectors(sector + runOffset / bytesPerSector, chunk / bytesPerSector, block.data(), bytesPerSector)) {
+                return false;
+            }
+
+            uint64_t toCopy = (std::min)(static_cast<uint64_t>(chunk), bitmapSize - bytesDone);
+            std::memcpy(bitmap.data() + bytesDone, block.data(), static_cast<size_t>(toCopy));
+            bytesDone += toCopy;
+            runOffset += chunk;
+        }
+        if (bytesDone >= bitmapSize) break;
+    }
+
+    volumeBitmap.assign(bitmap, driveInfo.totalClusters);
+    return true;
+}
+
+// Register the runs of files before any of them is analyzed. Called once for all candidates,
+// or for each batch while streaming, so a batch is compared with every file found so far
+void NTFSRecovery::buildOwnershipIndex(const std::vector<NTFSFileInfo>& files) {
+    std::cout << "[*] Indexing clusters of " << files.size() << " file(s)..." << std::endl;
+
+    for (const auto& file : files) {
+        if (!file.nonResident) continue;
+        ownershipIndex.addOwner(file.fileId, file.runs);
     }
+    ownershipIndex.build();
+}
 
+RecoveryStatus NTFSRecovery::processFileForRecovery(const NTFSFileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::wostream& out) {
+    bool isExtensionPredicted = false;
 
-    fs::path outputPath = utils.getOutputPath(fileInfo.fileName, config.outputFolder);
     uint64_t expectedSize = fileInfo.fileSize;
 
-    NTFSRecoveryStatus status = {};
+    RecoveryStatus status = {};
 
 
     status.expectedClusters = (expectedSize + driveInfo.bytesPerCluster - 1) / driveInfo.bytesPerCluster;
 
-    std::wcout << "[*] Current file: " << outputPath.filename() << " (" << expectedSize << " bytes)" << std::endl;
+    out << "[*] Current file: " << outputPath.filename() << " (" << expectedSize << " bytes)" << std::endl;
 
 
     if (fileInfo.nonResident) {
-        std::vector<uint64_t> clusterChain = validateClusterChain(status, fileInfo, expectedSize, outputPath, isExtensionPredicted);
-        if (config.recover) {
-            recoverNonResidentFile(clusterChain, status, outputPath, expectedSize);
+        validateClusterChain(status, fileInfo, outputPath, isExtensionPredicted, usedClusters, out);
+        if (config.recover && fileInfo.compressionUnit != 0) {
+            recoverCompressedFile(fileInfo, status, outputPath, expectedSize, out);
         }
     }
     else {
         if (config.recover) {
-            recoverResidentFile(fileInfo, outputPath);
+            recoverResidentFile(fileInfo, status, outputPath, out);
         }
     }
-    utils.printItemDivider();
+    utils.printItemDivider(out);
+    return status;
 }
 
-void NTFSRecovery::recoverResidentFile(const NTFSFileInfo& fileInfo, const fs::path& outputPath) {
-    std::cout << "[*] Recovering file..." << std::endl;
-    std::ofstream outputFile(outputPath, std::ios::binary);
-    if (!outputFile) {
-        throw std::runtime_error("[-] Failed to create output file.");
+void NTFSRecovery::recoverResidentFile(const NTFSFileInfo& fileInfo, RecoveryStatus& status, const fs::path& outputPath, std::wostream& out) {
+    out << "[*] Recovering file..." << std::endl;
+    if (archive) {
+        ArchiveSink::Member member(*archive, outputPath, fileInfo.data.size());
+        member.write(fileInfo.data.data(), fileInfo.data.size());
     }
-    outputFile.write(reinterpret_cast<const char*>(fileInfo.data.data()), fileInfo.data.size());
-    outputFile.close();
-    showRecoveryResult(outputPath);
+    else {
+        std::ofstream outputFile(outputPath, std::ios::binary);
+        if (!outputFile) {
+            throw std::runtime_error("[-] Failed to create output file.");
+        }
+        outputFile.write(reinterpret_cast<const char*>(fileInfo.data.data()), fileInfo.data.size());
+        outputFile.close();
+    }
+    status.recoveredBytes = fileInfo.data.size();
+    showRecoveryResult(outputPath, out);
 }
 
-std::vector<uint64_t> NTFSRecovery::validateClusterChain(NTFSRecoveryStatus& status, const NTFSFileInfo& fileInfo, uint64_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted) {
-    if (config.analyze) std::cout << "[!] Corruption analysis is not yet implemented for NTFS volumes." << std::endl;
-    std::set<uint64_t> usedClusters;
-    std::vector<uint64_t> clusterChain;
+void NTFSRecovery::validateClusterChain(RecoveryStatus& status, const NTFSFileInfo& fileInfo, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out) {
+    if (!config.analyze) return;
+    out << "[*] Analyzing file clusters..." << std::endl;
+
+    // Check for cluster reuse within the file and by live files, a whole run at a time
+    usedClusters.clear();
+    uint64_t allocatedClusters = 0;
+    for (const ClusterExtent& run : fileInfo.runs) {
+        if (run.sparse) continue;
+
+        // Report the first cluster actually in conflict, not the start of the run
+        uint64_t firstAllocated = UINT64_MAX;
+        uint64_t firstDuplicate = UINT64_MAX;
+        uint64_t runAllocated = volumeBitmap.isLoaded() ? volumeBitmap.countAllocated(run.start, run.length, &firstAllocated) : 0;
+        uint64_t runDuplicates = usedClusters.insertRange(run.start, run.length, &firstDuplicate);
+        allocatedClusters += runAllocated;
+        if (runDuplicates > 0 || runAllocated > 0) {
+            status.isCorrupted = true;
+            status.hasOverwrittenClusters = true;
+            status.problematicClusters.push_back((std::min)(firstDuplicate, firstAllocated));
+        }
+    }
+
+    if (allocatedClusters > 0) {
+        double allocatedPercentage = status.expectedClusters ? (static_cast<double>(allocatedClusters) / status.expectedClusters) * 100.0 : 0.0;
+        out << "  [-] " << allocatedClusters << " cluster(s) ("
+            << std::fixed << std::setprecision(2) << (std::min)(allocatedPercentage, 100.0)
+            << "%) are allocated to live files" << std::endl;
+    }
 
-    uint64_t startCluster = fileInfo.cluster;
-    uint64_t length = fileInfo.runLength;
-    for (uint64_t i = 0; i < length; ++i) {
-        uint64_t currentCluster = startCluster + i;
+    // Clusters claimed by other deleted records
+    auto overwriteAnalysis = ownershipIndex.analyzeOverwrites(fileInfo.fileId, status.expectedClusters);
+    CorruptionAnalyzer::applyOverwriteAnalysis(overwriteAnalysis, status, out);
 
-        // Avoid duplicates
-        if (usedClusters.insert(currentCluster).second) {
-            clusterChain.push_back(currentCluster);
+    status.hasInvalidFileName = CorruptionAnalyzer::isFileNameCorrupted(outputPath.filename().wstring());
+    if (status.hasInvalidFileName) {
+        status.isCorrupted = true;
+    }
+
+    // Check if extension was either missing or had invalid characters
+    if (isExtensionPredicted) {
+        status.isCorrupted = true;
+        status.hasInvalidExtension = true;
+    }
+
+    CorruptionAnalyzer::analyzeClusterPattern<uint64_t>(fileInfo.runs, status);
+    CorruptionAnalyzer::showAnalysisResult(status, out);
+}
+
+// Take the next unitCount compression units off the run list and read their allocated clusters
+void NTFSRecovery::readCompressionUnits(const std::vector<ClusterExtent>& runs, size_t& runIndex, uint64_t& runOffset, uint64_t clustersPerUnit, size_t unitCount, std::vector<CompressionUnit>& units) {
+    units.clear();
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+
+    while (units.size() < unitCount && runIndex < runs.size()) {
+        CompressionUnit unit = {};
+        unit.isReadable = true;
+
+        // A unit may span several runs, its sparse tail marks how much of it is compressed
+        uint64_t unitClusters = 0;
+        while (unitClusters < clustersPerUnit && runIndex < runs.size()) {
+            const ClusterExtent& run = runs[runIndex];
+            uint64_t count = (std::min)(run.length - runOffset, clustersPerUnit - unitClusters);
+            if (!run.sparse) {
+                unit.extents.push_back({ run.start + runOffset, count, false });
+                unit.allocatedClusters += count;
+            }
+            unitClusters += count;
+            runOffset += count;
+            if (runOffset == run.length) {
+                runIndex++;
+                runOffset = 0;
+            }
         }
+
+        unit.raw.resize(static_cast<size_t>(unit.allocatedClusters * driveInfo.bytesPerCluster));
+        size_t rawOffset = 0;
+        for (const ClusterExtent& extent : unit.extents) {
+            size_t extentBytes = static_cast<size_t>(extent.length * driveInfo.bytesPerCluster);
+            RecoveryScheduler::ReadSlot slot(scheduler, extentBytes);
+            if (!sectorReader->readSectors(clusterToSector(extent.start), static_cast<uint32_t>(extentBytes / bytesPerSector), unit.raw.data() + rawOffset, bytesPerSector)) {
+                unit.isReadable = false;
+            }
+            rawOffset += extentBytes;
+        }
+        units.push_back(std::move(unit));
     }
-    return clusterChain;
 }
 
-void NTFSRecovery::recoverNonResidentFile(const std::vector<uint64_t>& clusterChain, NTFSRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize) {
-    std::cout << "[*] Recovering file..." << std::endl;
-    std::ofstream outputFile(outputPath, std::ios::binary);
-    if (!outputFile) {
+void NTFSRecovery::decodeCompressionUnits(std::vector<CompressionUnit>& units, uint64_t clustersPerUnit, size_t unitSize) {
+    for (CompressionUnit& unit : units) {
+
+        // A fully allocated unit was stored uncompressed, a fully sparse one is zeros
+        if (unit.allocatedClusters == clustersPerUnit) {
+            unit.data = std::move(unit.raw);
+            unit.isDecoded = true;
+        }
+        else if (unit.allocatedClusters == 0) {
+            unit.data.assign(unitSize, 0);
+            unit.isDecoded = true;
+        }
+        else {
+            unit.data.resize(unitSize);
+            unit.isDecoded = Lznt1::decompressUnit(unit.raw.data(), unit.raw.size(), unit.data.data(), unitSize);
+        }
+    }
+}
+
+void NTFSRecovery::recoverCompressedFile(const NTFSFileInfo& fileInfo, RecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize, std::wostream& out) {
+    out << "[*] Recovering compressed file..." << std::endl;
+    if (fileInfo.compressionUnit > MAX_COMPRESSION_UNIT) {
+        out << "[-] Unsupported compression unit size" << std::endl;
+        return;
+    }
+
+    // Sparse compression units decode to zeros, the writer turns them back into holes. An archive
+    // member is held for the whole file, other jobs writing to the archive wait for it
+    OutputFile outputFile;
+    std::unique_ptr<ArchiveSink::Member> member;
+    if (archive) {
+        member = std::make_unique<ArchiveSink::Member>(*archive, outputPath, expectedSize);
+    }
+    else if (!outputFile.open(outputPath, false)) {
         throw std::runtime_error("[-] Failed to create output file.");
     }
-    // Recovery
-    for (uint64_t cluster : clusterChain) {
-        uint64_t sector = clusterToSector(cluster);
 
-        for (uint64_t i = 0; i < driveInfo.bootSector.sectorsPerCluster; ++i) {
-            std::vector<uint8_t> sectorBuffer(driveInfo.bootSector.bytesPerSector);
-            if (!readSector(sector + i, sectorBuffer.data(), driveInfo.bootSector.bytesPerSector)) {
-                continue;
+    const uint64_t clustersPerUnit = 1ULL << fileInfo.compressionUnit;
+    const size_t unitSize = static_cast<size_t>(clustersPerUnit * driveInfo.bytesPerCluster);
+    size_t runIndex = 0;
+    uint64_t runOffset = 0;
+    uint64_t unitIndex = 0;
+
+    // Read the next batch on a helper thread while this worker decodes the current one. Decoding
+    // stays on the worker, other workers of the scheduler already keep the remaining cores busy
+    std::vector<CompressionUnit> current;
+    std::vector<CompressionUnit> next;
+    readCompressionUnits(fileInfo.runs, runIndex, runOffset, clustersPerUnit, COMPRESSION_BATCH_UNITS, current);
+
+    while (!current.empty() && status.recoveredBytes < expectedSize) {
+        uint64_t batchEnd = (unitIndex + current.size()) * unitSize;
+        auto reading = std::async(std::launch::async, [&, batchEnd]() {
+            if (batchEnd < expectedSize) {
+                readCompressionUnits(fileInfo.runs, runIndex, runOffset, clustersPerUnit, COMPRESSION_BATCH_UNITS, next);
+            }
+            else {
+                next.clear();
+            }
+        });
+        decodeCompressionUnits(current, clustersPerUnit, unitSize);
+        reading.get();
+
+        for (CompressionUnit& unit : current) {
+            if (!unit.isReadable || !unit.isDecoded) {
+                out << "  [-] Compression unit " << unitIndex << " could not be " << (unit.isReadable ? "decompressed" : "read") << std::endl;
+                status.isCorrupted = true;
+                if (!unit.extents.empty()) status.problematicClusters.push_back(unit.extents.front().start);
             }
 
-            uint64_t bytesToWrite = (std::min)(
-                static_cast<uint64_t>(driveInfo.bootSector.bytesPerSector),
-                expectedSize - status.recoveredBytes
-                );
-
-            outputFile.write(reinterpret_cast<char*>(sectorBuffer.data()), bytesToWrite);
+            uint64_t bytesToWrite = (std::min)(static_cast<uint64_t>(unit.data.size()), expectedSize - status.recoveredBytes);
+            if (member) member->write(unit.data.data(), static_cast<size_t>(bytesToWrite));
+            else outputFile.write(status.recoveredBytes, unit.data.data(), static_cast<size_t>(bytesToWrite));
             status.recoveredBytes += bytesToWrite;
-            utils.showProgress(status.recoveredBytes, expectedSize);
-
+            status.recoveredClusters += unit.allocatedClusters;
+            unitIndex++;
             if (status.recoveredBytes >= expectedSize) break;
         }
-        status.recoveredClusters++;
-        if (status.recoveredBytes >= expectedSize) break;
+        std::swap(current, next);
     }
+    if (member) member.reset();
+    else outputFile.setSize(status.recoveredBytes);
     outputFile.close();
-    std::cout << "\n";
-    showRecoveryResult(outputPath);
+    showRecoveryResult(outputPath, out);
 }
 
-/* Recovery and analysis results */
-void NTFSRecovery::showRecoveryResult(const fs::path& outputPath) const {
-    if (fs::exists(fs::absolute(outputPath))) {
-        std::wcout << "  [+] File saved to " << fs::absolute(outputPath) << L"\n";
+// Reads the run lists of all selected uncompressed non-resident files in one pass over the volume
+void NTFSRecovery::recoverInDiskOrder(const std::vector<const NTFSFileInfo*>& files, const std::vector<fs::path>& outputPaths, std::vector<RecoveryStatus>& results) {
+    std::vector<uint32_t> planned;
+    for (uint32_t i = 0; i < files.size(); i++) {
+        if (files[i]->nonResident && files[i]->compressionUnit == 0) planned.push_back(i);
+    }
+    if (planned.empty()) return;
+
+    utils.printHeader("Recovering Files:");
+    uint32_t bytesPerSector = driveInfo.bootSector.bytesPerSector;
+    auto clusterToOffset = [this, bytesPerSector](uint64_t cluster) {
+        return clusterToSector(cluster) * bytesPerSector;
+    };
+
+    ReadPlanner planner;
+    OutputFileCache plainFiles;
+    OutputSink& outputs = archive ? static_cast<OutputSink&>(*archive) : plainFiles;
+    planner.reset(files.size());
+    for (uint32_t i : planned) {
+        outputs.addFile(i, outputPaths[i], files[i]->fileSize);
+        planner.addFile(i, files[i]->runs, files[i]->fileSize, driveInfo.bytesPerCluster, clusterToOffset);
     }
-    else std::wcout << "  [-] Failed to save file" << std::endl;
+
+    planner.execute(*sectorReader, scheduler, bytesPerSector, static_cast<uint64_t>(config.readGapKiB) * 1024, outputs,
+        [this](uint64_t done, uint64_t total) { utils.showProgress(done, total); });
+    outputs.finish();
+
+    for (uint32_t i : planned) {
+        // Sparse runs were never allocated and read back as zeros
+        const ReadPlanner::FileTotals& totals = planner.getTotals(i);
+        results[i].recoveredBytes = totals.readBytes + totals.sparseBytes;
+        results[i].recoveredClusters = (totals.readBytes + driveInfo.bytesPerCluster - 1) / driveInfo.bytesPerCluster;
+        std::wcout << "[*] " << outputPaths[i].filename() << ": " << results[i].recoveredBytes << " / " << files[i]->fileSize << " bytes" << std::endl;
+        showRecoveryResult(outputPaths[i], std::wcout);
+    }
+    utils.printItemDivider();
+}
+
+/* Recovery and analysis results */
+void NTFSRecovery::showRecoveryResult(const fs::path& outputPath, std::wostream& out) const {
+    utils.showSavedFile(outputPath, out);
 }
 // implement analysis
 
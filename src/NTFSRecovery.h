@@ -5,9 +5,22 @@
 #include "LogicalDriveReader.h"
 #include "SectorReader.h"
 #include "Enums.h"
+#include "ClusterBitset.h"
+#include "ClusterOwnershipIndex.h"
+#include "VolumeBitmap.h"
+#include "MftDirectoryIndex.h"
+#include "Lznt1.h"
+#include "CorruptionAnalyzer.h"
+#include "RecoveryScheduler.h"
+#include "ReadPlanner.h"
+#include "OutputFileCache.h"
+#include "BoundedQueue.h"
+#include "ArchiveSink.h"
 
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <fstream>
 #include <filesystem>
@@ -24,6 +37,8 @@ private:
         uint32_t bytesPerSector; // in case the sector size is greater than the default size in boot sector
         uint32_t mftRecordSize;
         uint32_t bytesPerCluster;
+        uint64_t totalClusters;
+        uint64_t totalMftRecords;
         uint64_t mftOffset;
     } driveInfo;
 
@@ -31,7 +46,62 @@ private:
 
     std::unique_ptr<SectorReader> sectorReader;
     std::vector<NTFSFileInfo> recoveryList;
-    uint16_t fileId = 1;
+    uint32_t fileId = 1;
+    std::vector<ClusterBitset> workerClusters; // duplicate clusters within one file, one per recovery worker and cleared per file
+    RecoveryScheduler scheduler; // recovers the selected files in parallel
+    std::unique_ptr<BoundedQueue<NTFSFileInfo>> streamQueue; // files found so far, only while streaming
+    std::unique_ptr<ArchiveSink> archive; // all recovered files, only when writing to an archive
+    ClusterOwnershipIndex ownershipIndex; // runs claimed by more than one deleted record, built over all candidates
+    VolumeBitmap volumeBitmap; // $Bitmap, clusters currently allocated to live files
+    MftDirectoryIndex directoryIndex; // parent and name of every record, for rebuilding paths
+
+    // Deleted files spread over several records, joined once the MFT pass is done
+    std::unordered_map<uint64_t, std::vector<DataAttributePiece>> extensionPieces; // base record -> $DATA pieces
+    std::vector<NTFSFileInfo> pendingFiles; // deleted base records with an $ATTRIBUTE_LIST
+
+    // Directory index blocks, read one directory at a time once the MFT pass is done
+    struct IndexAllocation {
+        uint64_t directoryRecord;
+        std::vector<ClusterExtent> runs;
+    };
+    std::vector<IndexAllocation> indexAllocations;
+    std::vector<IndexSlackEntry> indexSlackEntries; // names without a usable MFT record
+
+    static constexpr uint64_t MFT_REFERENCE_MASK = 0x0000FFFFFFFFFFFFULL; // record number part of a file reference
+    static constexpr uint32_t MAX_ATTRIBUTE_LIST_SIZE = 16 * 1024 * 1024;
+    static constexpr uint64_t MFT_RECORD_NUMBER = 0;           // $MFT
+    static constexpr uint64_t MFTMIRR_RECORD_NUMBER = 1;       // $MFTMirr
+    static constexpr uint64_t BITMAP_RECORD_NUMBER = 6;        // $Bitmap
+    static constexpr const wchar_t* CARVED_FOLDER = L"$Carved"; // output of records found outside the MFT
+    static constexpr uint32_t FIXUP_STRIDE = 512;              // update sequence array protects every 512 bytes
+    static constexpr uint32_t CARVE_READ_BLOCK_SIZE = 4 * 1024 * 1024;
+    static constexpr uint32_t INDEX_READ_BLOCK_SIZE = 1024 * 1024;
+    static constexpr uint64_t ROOT_DIRECTORY_RECORD = 5;
+    static constexpr uint64_t EXTEND_RECORD_NUMBER = 11;       // $Extend
+    static constexpr uint32_t USN_READ_BLOCK_SIZE = 4 * 1024 * 1024;
+    static constexpr uint32_t USN_REASON_FILE_DELETE = 0x00000200;
+    static constexpr uint64_t FILETIME_TICKS_PER_DAY = 864000000000ULL;
+    static constexpr uint64_t LOGFILE_RECORD_NUMBER = 2;       // $LogFile
+    static constexpr uint32_t RSTR_SIGNATURE = 0x52545352;     // "RSTR" in little endian
+    static constexpr uint32_t RCRD_SIGNATURE = 0x44524352;     // "RCRD" in little endian
+    static constexpr uint32_t MAX_LOG_RECORD_SIZE = 64 * 1024; // longer records are skipped, not buffered
+    static constexpr uint32_t INDX_SIGNATURE = 0x58444E49;      // "INDX" in little endian
+    // FILETIME bounds for carved timestamps, 1980-01-01 and 2100-01-01
+    static constexpr uint64_t MIN_PLAUSIBLE_FILETIME = 119600064000000000ULL;
+    static constexpr uint64_t MAX_PLAUSIBLE_FILETIME = 157469184000000000ULL;
+    static constexpr uint8_t MAX_COMPRESSION_UNIT = 8;         // 256 clusters, NTFS itself only uses 16
+    static constexpr size_t COMPRESSION_BATCH_UNITS = 64;      // units read while the previous batch is decoded
+
+    // One compression unit of a compressed file on its way from disk to the output
+    struct CompressionUnit {
+        std::vector<ClusterExtent> extents; // allocated part of the unit, a fully sparse unit has none
+        uint64_t allocatedClusters;
+        std::vector<uint8_t> raw;
+        std::vector<uint8_t> data;
+        bool isReadable;
+        bool isDecoded;
+    };
+    static constexpr uint32_t BITMAP_READ_BLOCK_SIZE = 4 * 1024 * 1024;
 
     void printToolHeader() const;
 
@@ -54,24 +124,73 @@ private:
     /* Search for deleted files */
     void scanForDeletedFiles();
     void scanMFT();
-    void processMftRecord(std::vector<uint8_t>& mftBuffer);
+    void processMftRecord(std::vector<uint8_t>& mftBuffer, uint64_t recordNumber, bool isCarved = false);
+    // Restore the last two bytes of every 512-byte stride from the update sequence array (FILE and INDX)
+    bool applyFixups(uint8_t* block, uint32_t blockSize) const;
+    bool isPlausibleFileRecord(const uint8_t* record) const;
+    void carveFileRecords();
+    std::vector<std::pair<uint64_t, uint64_t>> getLiveMftRanges();
+    void processRecordSlack(const std::vector<uint8_t>& mftBuffer, uint64_t recordNumber);
+    void queueIndexAllocation(const AttributeHeader* attr, const uint8_t* attrData, uint64_t directoryRecord);
+    void scanIndexSlack();
+    void carveIndexSlack(const uint8_t* indexBlock, uint32_t indexBlockSize, uint64_t directoryRecord, std::vector<IndexSlackEntry>& found) const;
+    void logIndexSlackEntries();
+    static std::wstring formatFileTime(uint64_t fileTime);
+
+    /* Change journal */
+    bool readMftRecordByNumber(uint64_t record, std::vector<uint8_t>& mftBuffer);
+    const AttributeHeader* findAttribute(const std::vector<uint8_t>& mftBuffer, uint32_t type, const std::wstring& name) const;
+    bool findIndexEntry(const uint8_t* node, size_t nodeSize, const std::wstring& name, uint64_t& fileReference) const;
+    bool findUsnJournal(std::vector<ClusterExtent>& runs, uint64_t& streamSize);
+    void parseUsnRecords(const uint8_t* data, size_t size, uint64_t cutoffTime, std::unordered_map<uint64_t, UsnDeletionEvent>& deletions) const;
+    void indexParentChain(uint64_t directoryRecord, std::vector<uint8_t>& mftBuffer);
+    bool scanUsnJournal();
+
+    /* $LogFile */
+    void scanLogFile();
+    void processLogRecord(const uint8_t* clientData, size_t clientDataLength, std::unordered_map<uint64_t, LogFileCandidate>& candidates) const;
+    void applyLoggedAttribute(const uint8_t* image, size_t imageLength, LogFileCandidate& candidate) const;
+    void addLogFileCandidates(std::unordered_map<uint64_t, LogFileCandidate>& candidates);
     bool readMftRecord(std::vector<uint8_t>& mftBuffer, const uint32_t sectorsPerMftRecord, const uint64_t currentSector);
-    void processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSFileInfo& fileInfo, uint32_t attributeOffset, bool& hasFileName, bool& hasData, bool isDeleted);
-    void processFileNameAttribute(const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo);
+    void processAttribute(const std::vector<uint8_t>& mftBuffer, NTFSFileInfo& fileInfo, std::vector<NTFSFileInfo>& namedStreams, uint32_t attributeOffset, bool& hasFileName, bool& hasData, bool isDeleted);
+    NTFSFileInfo& getNamedStream(const AttributeHeader* attr, const uint8_t* attrData, std::vector<NTFSFileInfo>& namedStreams) const;
+    void addNamedStreams(const NTFSFileInfo& fileInfo, std::vector<NTFSFileInfo>& namedStreams);
+    void processExtensionRecord(const std::vector<uint8_t>& mftBuffer, uint64_t recordNumber, bool isDeleted);
+    void processAttributeList(const AttributeHeader* attr, const uint8_t* attrData, NTFSFileInfo& fileInfo);
+    bool isListedPiece(const NTFSFileInfo& fileInfo, const DataAttributePiece& piece) const;
+    void joinExtensionRuns(NTFSFileInfo& fileInfo);
+    void completePendingFiles();
+    void processFileNameAttribute(const MFTEntryHeader* entry, const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo);
+    void parseDataRuns(const AttributeHeader* attr, const uint8_t* attrData, std::vector<ClusterExtent>& runs) const;
     void processDataAttribute(const AttributeHeader* attr, const uint8_t* attrData, bool isDeleted, NTFSFileInfo& fileInfo);
     void addToRecoveryList(const NTFSFileInfo& fileInfo);
+    // Path of a file relative to the volume root, named streams as "file:stream"
+    std::wstring getRelativePath(const NTFSFileInfo& fileInfo);
+    // Name of the output file, named streams as "file_stream"
+    std::wstring getOutputName(const NTFSFileInfo& fileInfo) const;
 
 
     /* Recover files */
     std::vector<NTFSFileInfo> selectFilesToRecover(const std::vector<NTFSFileInfo>& recoveryList);
     void runLogicalDriveRecovery();
+    // Scan and recover at the same time, see --stream
+    void runStreamingRecovery();
     void recoverPartition();
-    void processFileForRecovery(const NTFSFileInfo& fileInfo);
-    void recoverResidentFile(const NTFSFileInfo& fileInfo, const fs::path& outputPath);
-    std::vector<uint64_t> validateClusterChain(NTFSRecoveryStatus& status, const NTFSFileInfo& fileInfo, uint64_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted);
-    void recoverNonResidentFile(const std::vector<uint64_t>& clusterChain, NTFSRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize);
-
-    void showRecoveryResult(const fs::path& outputPath) const;
+    // Analyze and recover one group of files, returns their results in order
+    std::vector<RecoveryStatus> recoverFiles(const std::vector<NTFSFileInfo>& files);
+    bool loadVolumeBitmap();
+    void buildOwnershipIndex(const std::vector<NTFSFileInfo>& files);
+    // Runs on a recovery worker, everything it prints goes to out
+    RecoveryStatus processFileForRecovery(const NTFSFileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::wostream& out);
+    void recoverResidentFile(const NTFSFileInfo& fileInfo, RecoveryStatus& status, const fs::path& outputPath, std::wostream& out);
+    void validateClusterChain(RecoveryStatus& status, const NTFSFileInfo& fileInfo, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out);
+    void readCompressionUnits(const std::vector<ClusterExtent>& runs, size_t& runIndex, uint64_t& runOffset, uint64_t clustersPerUnit, size_t unitCount, std::vector<CompressionUnit>& units);
+    static void decodeCompressionUnits(std::vector<CompressionUnit>& units, uint64_t clustersPerUnit, size_t unitSize);
+    void recoverCompressedFile(const NTFSFileInfo& fileInfo, RecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize, std::wostream& out);
+    // Read the data of all uncompressed non-resident files in one sweep sorted by position on the volume
+    void recoverInDiskOrder(const std::vector<const NTFSFileInfo*>& files, const std::vector<fs::path>& outputPaths, std::vector<RecoveryStatus>& results);
+
+    void showRecoveryResult(const fs::path& outputPath, std::wostream& out) const;
 
 public:
     NTFSRecovery(const DriveType& driveType, std::unique_ptr<SectorReader> reader);
@@ -1,4 +1,5 @@
 #pragma once
+#include "Structures.h"
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -6,13 +7,62 @@
 
 #pragma pack(push, 1)
 
+// $DATA piece listed in a base record's $ATTRIBUTE_LIST
+struct AttributeListSegment {
+    uint64_t startingVCN;
+    uint64_t segmentReference; // record holding the piece, sequence number in the high 16 bits
+};
+
+// Piece of a deleted file's non-resident $DATA found in one of its extension records
+struct DataAttributePiece {
+    uint64_t record;
+    uint16_t sequence;
+    uint64_t startingVCN;
+    uint64_t realSize; // only meaningful in the piece starting at VCN 0
+    uint8_t compressionUnit; // same
+    std::vector<ClusterExtent> runs;
+};
+
+// Deleted name carved from INDX slack, its MFT record may already belong to another file
+struct IndexSlackEntry {
+    std::wstring fileName;
+    uint64_t fileReference;
+    uint64_t parentRecord;
+    uint64_t fileSize;
+    uint64_t creationTime;     // FILETIME
+    uint64_t modificationTime; // FILETIME
+};
+
+// Deletion read from the $UsnJrnl:$J change journal
+struct UsnDeletionEvent {
+    uint64_t fileReference;
+    uint64_t parentReference;
+    uint64_t timeStamp;        // FILETIME
+    std::wstring fileName;
+};
+
+// File metadata pieced together from $LogFile redo/undo images of one MFT record
+struct LogFileCandidate {
+    std::wstring fileName;
+    uint64_t parentReference;
+    uint64_t fileSize;
+    std::vector<ClusterExtent> runs;
+    uint8_t compressionUnit; // log2 of clusters per LZNT1 compression unit, 0 if not compressed
+};
+
 struct NTFSFileInfo {
     std::wstring fileName;
-    uint16_t fileId;
+    std::wstring streamName; // empty for the unnamed $DATA stream
+    uint32_t fileId;
+    uint64_t recordNumber; // MFT record holding the file, key into the directory index
     uint64_t fileSize;
-    uint64_t cluster; // non-resident
-    uint64_t runLength; // non-resident
+    uint64_t cluster; // non-resident, first allocated cluster
+    std::vector<ClusterExtent> runs; // non-resident, data runs in VCN order
+    uint8_t compressionUnit; // non-resident, log2 of clusters per LZNT1 compression unit, 0 if not compressed
     std::vector<uint8_t> data; // resident
+    std::vector<AttributeListSegment> dataSegments; // from $ATTRIBUTE_LIST, empty if the list could not be read
+    bool hasAttributeList;
+    bool isCarved; // found outside the current MFT, record number means nothing in the directory index
     bool nonResident;
 };
 
@@ -74,6 +124,17 @@ struct AttributeHeader {
     uint16_t attributeId;
 };
 
+// $ATTRIBUTE_LIST entry
+struct AttributeListEntry {
+    uint32_t type;
+    uint16_t length;
+    uint8_t  nameLength;
+    uint8_t  nameOffset;
+    uint64_t startingVCN;
+    uint64_t segmentReference;
+    uint16_t attributeId;
+};
+
 // Resident Attribute Header
 struct ResidentAttributeHeader : AttributeHeader {
     uint32_t contentLength;
@@ -92,6 +153,133 @@ struct NonResidentAttributeHeader : AttributeHeader {
     uint64_t initializedSize;
 };
 
+// INDX block of $INDEX_ALLOCATION, followed by the index node header
+struct IndexBlockHeader {
+    uint32_t signature;          // "INDX"
+    uint16_t updateSequenceOffset;
+    uint16_t updateSequenceSize;
+    uint64_t logFileSequenceNumber;
+    uint64_t vcn;
+    uint32_t entriesOffset;      // offsets and sizes below are relative to this field
+    uint32_t indexLength;        // used part of the node, slack starts after it
+    uint32_t allocatedSize;
+    uint32_t flags;
+};
+
+// $INDEX_ROOT content, the index node header follows at nodeOffset
+struct IndexRootHeader {
+    uint32_t attributeType;
+    uint32_t collationRule;
+    uint32_t indexBlockSize;
+    uint8_t  clustersPerIndexBlock;
+    uint8_t  padding[3];
+    uint32_t entriesOffset;      // relative to this field, like in IndexBlockHeader
+    uint32_t indexLength;
+    uint32_t allocatedSize;
+    uint32_t flags;
+};
+
+// Index entry, a $FILE_NAME key follows for directory indexes
+struct IndexEntryHeader {
+    uint64_t fileReference;
+    uint16_t entryLength;
+    uint16_t keyLength;
+    uint32_t flags;
+};
+
+// $LogFile restart page
+struct LogRestartPageHeader {
+    uint32_t signature;          // "RSTR"
+    uint16_t updateSequenceOffset;
+    uint16_t updateSequenceSize;
+    uint64_t chkdskLsn;
+    uint32_t systemPageSize;
+    uint32_t logPageSize;
+    uint16_t restartAreaOffset;
+    int16_t  minorVersion;
+    int16_t  majorVersion;
+};
+
+// $LogFile record page
+struct LogRecordPageHeader {
+    uint32_t signature;          // "RCRD"
+    uint16_t updateSequenceOffset;
+    uint16_t updateSequenceSize;
+    uint64_t lastLsn;
+    uint32_t flags;
+    uint16_t pageCount;
+    uint16_t pagePosition;
+    uint16_t nextRecordOffset;   // free space of the page
+    uint8_t  reserved[6];
+    uint64_t lastEndLsn;
+};
+
+// LFS record header, client data follows
+struct LogRecordHeader {
+    uint64_t thisLsn;
+    uint64_t clientPreviousLsn;
+    uint64_t clientUndoNextLsn;
+    uint32_t clientDataLength;
+    uint32_t clientId;
+    uint32_t recordType;         // 1 = client record, 2 = client restart
+    uint32_t transactionId;
+    uint16_t flags;              // 0x0001 = continues on the next page
+    uint8_t  reserved[6];
+};
+
+// NTFS client data of a log record, redo and undo images are relative to its start
+struct NTFSLogRecordHeader {
+    uint16_t redoOperation;
+    uint16_t undoOperation;
+    uint16_t redoOffset;
+    uint16_t redoLength;
+    uint16_t undoOffset;
+    uint16_t undoLength;
+    uint16_t targetAttribute;
+    uint16_t lcnsToFollow;
+    uint16_t recordOffset;
+    uint16_t attributeOffset;
+    uint16_t clusterBlockOffset; // in 512-byte blocks
+    uint16_t reserved;
+    uint64_t targetVcn;
+};
+
+// Change journal record, versions 2 and 3 share the header
+struct UsnRecordHeader {
+    uint32_t recordLength;
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+};
+
+struct UsnRecordV2 : UsnRecordHeader {
+    uint64_t fileReference;
+    uint64_t parentFileReference;
+    int64_t  usn;
+    uint64_t timeStamp;
+    uint32_t reason;
+    uint32_t sourceInfo;
+    uint32_t securityId;
+    uint32_t fileAttributes;
+    uint16_t fileNameLength;     // in bytes
+    uint16_t fileNameOffset;     // from the start of the record
+};
+
+// Version 3 widens the references to 128 bits (ReFS), NTFS only uses the low half
+struct UsnRecordV3 : UsnRecordHeader {
+    uint64_t fileReference;
+    uint64_t fileReferenceHigh;
+    uint64_t parentFileReference;
+    uint64_t parentFileReferenceHigh;
+    int64_t  usn;
+    uint64_t timeStamp;
+    uint32_t reason;
+    uint32_t sourceInfo;
+    uint32_t securityId;
+    uint32_t fileAttributes;
+    uint16_t fileNameLength;
+    uint16_t fileNameOffset;
+};
+
 // File Name Attribute
 struct FileNameAttribute {
     uint64_t parentDirectory;
@@ -108,23 +296,4 @@ struct FileNameAttribute {
     wchar_t  name[1];
 };
 
-struct NTFSRecoveryStatus {
-    bool isCorrupted;
-    bool hasFragmentedClusters;
-    double fragmentation;
-    bool hasBackJumps;
-    uint32_t backJumps;
-    bool hasRepeatedClusters;
-    uint32_t repeatedClusters;
-    bool hasLargeGaps;
-    uint32_t largeGaps;
-    bool hasOverwrittenClusters;
-    bool hasInvalidFileName;
-    bool hasInvalidExtension;
-    uint64_t expectedClusters;
-    uint64_t recoveredClusters;
-    uint64_t recoveredBytes;
-    std::vector<uint64_t> problematicClusters;
-};
-
 #pragma pack(pop)
\ No newline at end of file
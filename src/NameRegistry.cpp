@@ -0,0 +1,48 @@
+#include "NameRegistry.h"
+#include <algorithm>
+#include <cwctype>
+#include <system_error>
+
+
+std::wstring NameRegistry::toKey(const std::wstring& name) {
+    std::wstring key = name;
+    std::transform(key.begin(), key.end(), key.begin(), ::towlower);
+    return key;
+}
+
+void NameRegistry::seed(const fs::path& folder, Folder& entry) {
+    std::error_code error;
+    for (fs::directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+        entry.names.insert(toKey(it->path().filename().wstring()));
+    }
+}
+
+fs::path NameRegistry::claim(const fs::path& folder, const std::wstring& fullName, bool isOnDisk) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::wstring folderKey = toKey(folder.wstring());
+    auto found = folders.find(folderKey);
+    if (found == folders.end()) {
+        found = folders.emplace(folderKey, Folder{}).first;
+        if (isOnDisk) seed(folder, found->second);
+    }
+    Folder& entry = found->second;
+
+    std::wstring requestKey = toKey(fullName);
+    if (entry.names.insert(requestKey).second) return folder / fullName;
+
+    // Leading dots belong to the name, not the extension
+    size_t dotPos = fullName.find_last_of(L'.');
+    if (dotPos == 0 || dotPos == std::wstring::npos) dotPos = fullName.size();
+    std::wstring fileName = fullName.substr(0, dotPos);
+    std::wstring extension = fullName.substr(dotPos);
+
+    // Resume where the last duplicate of this name stopped. Only names that were already taken
+    // some other way (e.g. "a_1.txt" on disk) are skipped here
+    uint32_t& counter = entry.nextSuffix[requestKey];
+    std::wstring newName;
+    do {
+        newName = fileName + L"_" + std::to_wstring(++counter) + extension;
+    } while (!entry.names.insert(toKey(newName)).second);
+    return folder / newName;
+}
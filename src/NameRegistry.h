@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// Hands out unique output names without probing the destination once per candidate. Every folder
+// is listed once, the first time a name is asked for in it, and from then on the names taken are
+// kept in memory. Names compare case-insensitively like on NTFS. A second "IMG_0001.JPG" becomes
+// "IMG_0001_1.JPG", and the next counter for each name is remembered, so a name shared by many
+// deleted files costs the same as a unique one. Files created in a folder by other programs after
+// it was listed are not seen
+class NameRegistry {
+private:
+    struct Folder {
+        std::unordered_set<std::wstring> names;            // Lower case
+        std::unordered_map<std::wstring, uint32_t> nextSuffix; // Lower case requested name -> next _N to try
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::wstring, Folder> folders;    // Lower case folder path
+
+    static std::wstring toKey(const std::wstring& name);
+    // Read the names already in folder, a folder that doesn't exist yet starts empty
+    static void seed(const fs::path& folder, Folder& entry);
+
+public:
+    // Reserve fullName in folder, or the first free "name_N.ext" after it. isOnDisk seeds the
+    // folder from the file system, archive members start from an empty folder
+    fs::path claim(const fs::path& folder, const std::wstring& fullName, bool isOnDisk);
+};
@@ -0,0 +1,95 @@
+#include "OutputFile.h"
+#include "SimdUtils.h"
+#include <algorithm>
+
+
+OutputFile::OutputFile()
+    : hFile(INVALID_HANDLE_VALUE) {}
+
+OutputFile::~OutputFile() {
+    close();
+}
+
+OutputFile::OutputFile(OutputFile&& other) noexcept
+    : hFile(other.hFile)
+    , holeBytes(other.holeBytes) {
+    other.hFile = INVALID_HANDLE_VALUE;
+}
+
+OutputFile& OutputFile::operator=(OutputFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        hFile = other.hFile;
+        holeBytes = other.holeBytes;
+        other.hFile = INVALID_HANDLE_VALUE;
+    }
+    return *this;
+}
+
+bool OutputFile::open(const fs::path& path, bool keepContents) {
+    close();
+
+    hFile = CreateFileW(
+        path.wstring().c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ,
+        NULL,
+        keepContents ? OPEN_ALWAYS : CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    // Fails on file systems without sparse files, the file is then written normally
+    DWORD bytesReturned;
+    DeviceIoControl(hFile, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytesReturned, NULL);
+    return true;
+}
+
+bool OutputFile::writeAt(uint64_t offset, const uint8_t* data, size_t length) {
+    // Offset is passed with the request, no separate seek
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD bytesWritten;
+
+    return WriteFile(hFile, data, static_cast<DWORD>(length), &bytesWritten, &overlapped) && bytesWritten == length;
+}
+
+bool OutputFile::write(uint64_t offset, const uint8_t* data, size_t length) {
+    if (!isOpen()) return false;
+
+    // Walk the range in blocks aligned to the file, only whole blocks can become holes.
+    // Data between two zero blocks goes out in one request
+    size_t pendingStart = 0;
+    size_t position = 0;
+    while (position < length) {
+        uint64_t blockEnd = ((offset + position) / HOLE_BLOCK_SIZE + 1) * HOLE_BLOCK_SIZE;
+        size_t blockLength = static_cast<size_t>((std::min)(blockEnd - (offset + position), static_cast<uint64_t>(length - position)));
+
+        if (blockLength == HOLE_BLOCK_SIZE && SimdUtils::isZeroBlock(data + position, blockLength)) {
+            if (position > pendingStart && !writeAt(offset + pendingStart, data + pendingStart, position - pendingStart)) return false;
+            holeBytes += blockLength;
+            pendingStart = position + blockLength;
+        }
+        position += blockLength;
+    }
+
+    if (length > pendingStart) return writeAt(offset + pendingStart, data + pendingStart, length - pendingStart);
+    return true;
+}
+
+bool OutputFile::setSize(uint64_t size) {
+    if (!isOpen()) return false;
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(hFile, distance, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+}
+
+void OutputFile::close() {
+    if (hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile);
+        hFile = INVALID_HANDLE_VALUE;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <windows.h>
+
+namespace fs = std::filesystem;
+
+// Recovered file on the destination drive. Writes are positional, and aligned blocks that are all
+// zeros are skipped instead of written. The file is marked sparse, so skipped blocks and the range
+// added by setSize stay unallocated holes that read back as zeros. On file systems without sparse
+// support (FAT32, exFAT) the same ranges are zero-filled by the file system
+class OutputFile {
+private:
+    HANDLE hFile;
+    uint64_t holeBytes = 0;
+
+    bool writeAt(uint64_t offset, const uint8_t* data, size_t length);
+
+public:
+    static constexpr uint64_t HOLE_BLOCK_SIZE = 64 * 1024; // NTFS deallocates sparse ranges in 64 KiB units
+
+    OutputFile();
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+    OutputFile(OutputFile&& other) noexcept;
+    OutputFile& operator=(OutputFile&& other) noexcept;
+
+    // keepContents reopens an existing file, otherwise it is created empty. Holes are only safe
+    // over ranges never written before, which holds for both uses
+    bool open(const fs::path& path, bool keepContents);
+    bool isOpen() const { return hFile != INVALID_HANDLE_VALUE; }
+    bool write(uint64_t offset, const uint8_t* data, size_t length);
+    // Truncate or extend to the logical size, an extension becomes a hole
+    bool setSize(uint64_t size);
+    void close();
+
+    // Zero bytes that were skipped rather than written
+    uint64_t getHoleBytes() const { return holeBytes; }
+};
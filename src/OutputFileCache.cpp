@@ -0,0 +1,66 @@
+#include "OutputFileCache.h"
+#include <algorithm>
+#include <iostream>
+
+
+OutputFileCache::OutputFileCache(size_t capacity)
+    : capacity((std::max)(capacity, static_cast<size_t>(1))) {}
+
+OutputFileCache::~OutputFileCache() {
+    finish();
+}
+
+void OutputFileCache::addFile(uint32_t target, const fs::path& path, uint64_t fileSize) {
+    files[target] = { path, fileSize };
+}
+
+void OutputFileCache::closeLeastRecent() {
+    holeBytes += openFiles.back().file.getHoleBytes();
+    openLookup.erase(openFiles.back().target);
+    openFiles.pop_back();
+}
+
+OutputFile* OutputFileCache::open(uint32_t target) {
+    auto cached = openLookup.find(target);
+    if (cached != openLookup.end()) {
+        openFiles.splice(openFiles.begin(), openFiles, cached->second);
+        return &openFiles.front().file;
+    }
+
+    auto pending = files.find(target);
+    if (pending == files.end()) return nullptr;
+
+    if (openFiles.size() >= capacity) closeLeastRecent();
+
+    // Reopening keeps what earlier pieces wrote
+    OutputFile file;
+    if (!file.open(pending->second.path, true)) return nullptr;
+
+    openFiles.push_front({ target, std::move(file) });
+    openLookup[target] = openFiles.begin();
+    return &openFiles.front().file;
+}
+
+bool OutputFileCache::write(uint32_t target, uint64_t offset, const uint8_t* data, size_t length) {
+    OutputFile* file = open(target);
+    if (!file) return false;
+    return file->write(offset, data, length);
+}
+
+void OutputFileCache::finish() {
+    if (files.empty()) return;
+
+    // Truncating to the logical size also turns a missing tail (sparse runs, data past
+    // ValidDataLength, unreadable pieces) into a hole
+    for (const auto& pending : files) {
+        OutputFile* file = open(pending.first);
+        if (file) file->setSize(pending.second.fileSize);
+    }
+    while (!openFiles.empty()) closeLeastRecent();
+    files.clear();
+
+    if (holeBytes) {
+        std::cout << "[*] " << holeBytes << " bytes of zeros left as holes instead of written" << std::endl;
+        holeBytes = 0;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "OutputSink.h"
+#include "OutputFile.h"
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+// Output files of a disk-order sweep. Pieces arrive in volume order rather than file order, so
+// writes are positional and the most recently used files stay open instead of reopening one per piece
+class OutputFileCache : public OutputSink {
+private:
+    struct PendingFile {
+        fs::path path;
+        uint64_t fileSize;
+    };
+    struct OpenFile {
+        uint32_t target;
+        OutputFile file;
+    };
+
+    std::unordered_map<uint32_t, PendingFile> files;
+    std::list<OpenFile> openFiles;   // Most recently used first
+    std::unordered_map<uint32_t, std::list<OpenFile>::iterator> openLookup;
+    size_t capacity;
+    uint64_t holeBytes = 0;          // Zero blocks of files already closed
+
+    // Open target or move it to the front, closing the least recently used file when full
+    OutputFile* open(uint32_t target);
+    void closeLeastRecent();
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    explicit OutputFileCache(size_t capacity = DEFAULT_CAPACITY);
+    ~OutputFileCache() override;
+
+    void addFile(uint32_t target, const fs::path& path, uint64_t fileSize) override;
+    bool write(uint32_t target, uint64_t offset, const uint8_t* data, size_t length) override;
+    // Close every file and set it to its final size, ranges never written are left as holes
+    void finish() override;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Destination of a recovery sweep. Every selected file is registered under a target number and
+// its data arrives as pieces written at an offset. Plain files take the pieces in volume order,
+// archives need them one file after another
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Register an output file and the size it must have once the sweep is done
+    virtual void addFile(uint32_t target, const fs::path& path, uint64_t fileSize) = 0;
+    virtual bool write(uint32_t target, uint64_t offset, const uint8_t* data, size_t length) = 0;
+    // Complete every registered file, ranges never written read back as zeros
+    virtual void finish() = 0;
+    // True if pieces must come in target order and, within a target, in offset order
+    virtual bool isSequential() const { return false; }
+};
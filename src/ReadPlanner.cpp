@@ -0,0 +1,210 @@
+#include "ReadPlanner.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+
+void ReadPlanner::reset(size_t fileCount) {
+    segments.clear();
+    totals.assign(fileCount, FileTotals{});
+}
+
+void ReadPlanner::addFile(uint32_t target, const std::vector<ClusterExtent>& extents, uint64_t dataLength, uint64_t bytesPerCluster,
+    const std::function<uint64_t(uint64_t)>& clusterToOffset) {
+    uint64_t fileOffset = 0;
+    for (const ClusterExtent& extent : extents) {
+        if (fileOffset >= dataLength) break;
+        uint64_t extentBytes = (std::min)(extent.length * bytesPerCluster, dataLength - fileOffset);
+
+        if (extent.sparse) {
+            totals[target].sparseBytes += extentBytes;
+            fileOffset += extentBytes;
+            continue;
+        }
+
+        // Split long extents so every segment fits in a single request
+        uint64_t diskOffset = clusterToOffset(extent.start);
+        for (uint64_t done = 0; done < extentBytes; done += MAX_READ_SIZE) {
+            uint64_t length = (std::min)(MAX_READ_SIZE, extentBytes - done);
+            segments.push_back({ target, fileOffset + done, diskOffset + done, length });
+        }
+        totals[target].plannedBytes += extentBytes;
+        fileOffset += extentBytes;
+    }
+}
+
+std::vector<ReadPlanner::Read> ReadPlanner::coalesce(uint64_t gapTolerance, uint32_t sectorSize, bool isFileOrder) {
+    if (isFileOrder) {
+        // Archives take one file after another, only the extents within a file can still merge
+        std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+            return a.target != b.target ? a.target < b.target : a.fileOffset < b.fileOffset;
+        });
+    }
+    else {
+        std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+            return a.diskOffset != b.diskOffset ? a.diskOffset < b.diskOffset : a.target < b.target;
+        });
+    }
+
+    std::vector<Read> reads;
+    size_t index = 0;
+    while (index < segments.size()) {
+        Read read = { segments[index].diskOffset, segments[index].length, index, 1 };
+        uint64_t readEnd = read.diskOffset + read.length;
+
+        // Overlapping segments (clusters claimed by two files) merge as well
+        while (index + read.segmentCount < segments.size()) {
+            const Segment& next = segments[index + read.segmentCount];
+            uint64_t nextEnd = (std::max)(readEnd, next.diskOffset + next.length);
+            if (next.diskOffset < read.diskOffset || next.diskOffset > readEnd + gapTolerance || nextEnd - read.diskOffset > MAX_READ_SIZE) break;
+            readEnd = nextEnd;
+            read.segmentCount++;
+        }
+
+        // File tails end mid-sector, the device only takes whole sectors
+        read.length = ((readEnd - read.diskOffset + sectorSize - 1) / sectorSize) * sectorSize;
+        reads.push_back(read);
+        index += read.segmentCount;
+    }
+    return reads;
+}
+
+// Spin on a ring operation for a short while, then sleep until the other stage moves a buffer.
+// Returns false if the other stage stopped first, and accounts the wait to the calling stage
+template <typename Operation, typename StopCondition>
+static bool waitFor(Operation tryOnce, StopCondition isOtherDone, std::mutex& mutex, std::condition_variable& changed,
+    uint64_t& stalls, double& waitSeconds) {
+    if (tryOnce()) return true;
+
+    auto start = std::chrono::steady_clock::now();
+    stalls++;
+    bool isDone = false;
+    for (uint32_t spins = 0; spins < ReadPlanner::SPIN_TRIES && !(isDone = tryOnce()); spins++) {
+        if (spins >= 64) std::this_thread::yield();
+    }
+    if (!isDone) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return (isDone = tryOnce()) || isOtherDone(); });
+    }
+    waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return isDone;
+}
+
+void ReadPlanner::readStage(SectorReader& reader, RecoveryScheduler& scheduler, uint32_t sectorSize, const std::vector<Read>& reads,
+    SpscRing<uint8_t*>& freeBuffers, SpscRing<ReadResult>& filledBuffers, StageSignal& signal, PipelineStats& stats) {
+    auto isWriterDone = [&signal]() { return signal.isWriterDone.load(); };
+
+    for (size_t index = 0; index < reads.size() && !isWriterDone(); index++) {
+        const Read& read = reads[index];
+        ReadResult result = { index, nullptr, true, {} };
+        if (!waitFor([&]() { return freeBuffers.tryPop(result.buffer); }, isWriterDone, signal.mutex, signal.changed,
+            stats.readerStalls, stats.readerWaitSeconds)) return;
+
+        {
+            RecoveryScheduler::ReadSlot slot(scheduler, read.length);
+            if (!reader.readSectors(read.diskOffset / sectorSize, static_cast<uint32_t>(read.length / sectorSize), result.buffer, sectorSize)) {
+                // Narrow the failure down to the segments that can't be read, each lands where the full read would have put it
+                result.isComplete = false;
+                result.segmentRead.assign(read.segmentCount, 0);
+                for (size_t i = 0; i < read.segmentCount; i++) {
+                    const Segment& segment = segments[read.firstSegment + i];
+                    uint64_t length = ((segment.length + sectorSize - 1) / sectorSize) * sectorSize;
+                    length = (std::min)(length, read.diskOffset + read.length - segment.diskOffset);
+                    result.segmentRead[i] = reader.readSectors(segment.diskOffset / sectorSize, static_cast<uint32_t>(length / sectorSize),
+                        result.buffer + (segment.diskOffset - read.diskOffset), sectorSize);
+                }
+            }
+        }
+
+        if (!waitFor([&]() { return filledBuffers.tryPush(result); }, isWriterDone, signal.mutex, signal.changed,
+            stats.readerStalls, stats.readerWaitSeconds)) return;
+        signal.notify();
+    }
+}
+
+void ReadPlanner::deliver(const Read& read, const ReadResult& result, OutputSink& outputs) {
+    for (size_t i = 0; i < read.segmentCount; i++) {
+        const Segment& segment = segments[read.firstSegment + i];
+        if (!result.isComplete && !result.segmentRead[i]) {
+            std::cout << "\n[!] Failed to read " << segment.length << " bytes at offset 0x" << std::hex << segment.diskOffset << std::dec << std::endl;
+            continue;
+        }
+        if (outputs.write(segment.target, segment.fileOffset, result.buffer + (segment.diskOffset - read.diskOffset), static_cast<size_t>(segment.length))) {
+            totals[segment.target].readBytes += segment.length;
+        }
+    }
+}
+
+void ReadPlanner::execute(SectorReader& reader, RecoveryScheduler& scheduler, uint32_t sectorSize, uint64_t gapTolerance, OutputSink& outputs,
+    const std::function<void(uint64_t, uint64_t)>& onProgress) {
+    std::vector<Read> reads = coalesce(gapTolerance, sectorSize, outputs.isSequential());
+
+    uint64_t totalBytes = 0;
+    for (const Read& read : reads) totalBytes += read.length;
+    std::cout << "[*] Reading " << segments.size() << " extent(s) in " << reads.size()
+        << (outputs.isSequential() ? " file-ordered" : " disk-ordered") << " request(s), " << totalBytes << " bytes..." << std::endl;
+    if (reads.empty()) return;
+
+    // Buffers go round between the two stages: free ring to the reader, filled ring to the writer
+    std::vector<std::vector<uint8_t>> pool(PIPELINE_BUFFERS, std::vector<uint8_t>(static_cast<size_t>(MAX_READ_SIZE + sectorSize)));
+    SpscRing<uint8_t*> freeBuffers(PIPELINE_BUFFERS);
+    SpscRing<ReadResult> filledBuffers(PIPELINE_BUFFERS);
+    for (auto& buffer : pool) {
+        uint8_t* data = buffer.data();
+        freeBuffers.tryPush(data);
+    }
+
+    // Each stage flags when it stops, normally or by an exception, so the other one never sleeps on it forever
+    PipelineStats stats = {};
+    StageSignal signal;
+    auto reading = std::async(std::launch::async, [&]() {
+        try {
+            readStage(reader, scheduler, sectorSize, reads, freeBuffers, filledBuffers, signal, stats);
+        }
+        catch (...) {
+            signal.isReaderDone = true;
+            signal.notify();
+            throw;
+        }
+        signal.isReaderDone = true;
+        signal.notify();
+    });
+    auto isReaderDone = [&signal]() { return signal.isReaderDone.load(); };
+
+    try {
+        uint64_t doneBytes = 0;
+        for (size_t done = 0; done < reads.size(); done++) {
+            ReadResult result = {};
+            if (!waitFor([&]() { return filledBuffers.tryPop(result); }, isReaderDone, signal.mutex, signal.changed,
+                stats.writerStalls, stats.writerWaitSeconds)) {
+                // The reader ended without passing on every buffer, get() rethrows its exception
+                reading.get();
+                throw std::runtime_error("[-] Read pipeline stopped early.");
+            }
+
+            const Read& read = reads[result.readIndex];
+            deliver(read, result, outputs);
+            freeBuffers.tryPush(result.buffer);
+            signal.notify();
+
+            doneBytes += read.length;
+            onProgress(doneBytes, totalBytes);
+        }
+    }
+    catch (...) {
+        signal.isWriterDone = true;
+        signal.notify();
+        if (reading.valid()) reading.wait();
+        throw;
+    }
+    reading.get();
+
+    // Writer waits mean the source is the bottleneck, reader waits mean the destination is
+    std::cout << "\n[*] Pipeline: reader waited " << stats.readerStalls << " time(s) ("
+        << std::fixed << std::setprecision(2) << stats.readerWaitSeconds << " s) on the writer, writer waited "
+        << stats.writerStalls << " time(s) (" << stats.writerWaitSeconds << " s) on the reader" << std::endl;
+}
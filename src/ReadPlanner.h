@@ -0,0 +1,100 @@
+#pragma once
+#include "Structures.h"
+#include "SectorReader.h"
+#include "OutputSink.h"
+#include "SpscRing.h"
+#include "RecoveryScheduler.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Elevator ordering for recovery reads. The extents of every selected file are collected first,
+// sorted by their position on the volume and merged when the gap between two of them is small,
+// then the volume is read front to back once and every piece goes to its own output file
+class ReadPlanner {
+public:
+    static constexpr uint64_t MAX_READ_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t PIPELINE_BUFFERS = 8; // Reads the reader may run ahead of the writer
+    static constexpr uint32_t SPIN_TRIES = 256;   // Ring checks before a stage goes to sleep
+
+    struct FileTotals {
+        uint64_t plannedBytes;  // Bytes backed by clusters
+        uint64_t readBytes;     // Of those, bytes read without error
+        uint64_t sparseBytes;   // Bytes of sparse runs, left as zeros
+    };
+
+private:
+    // Consecutive bytes on the volume that belong to one output file
+    struct Segment {
+        uint32_t target;
+        uint64_t fileOffset;
+        uint64_t diskOffset;
+        uint64_t length;
+    };
+    // One request covering one or more segments and the small gaps between them
+    struct Read {
+        uint64_t diskOffset;
+        uint64_t length;
+        size_t firstSegment;
+        size_t segmentCount;
+    };
+
+    // A filled buffer on its way from the reader to the writer
+    struct ReadResult {
+        size_t readIndex;
+        uint8_t* buffer;
+        bool isComplete;                  // The whole request succeeded
+        std::vector<char> segmentRead;    // Otherwise, which of its segments could be read on their own
+    };
+
+    // How often and how long each stage had to wait for the other one
+    struct PipelineStats {
+        uint64_t readerStalls;
+        uint64_t writerStalls;
+        double readerWaitSeconds;
+        double writerWaitSeconds;
+    };
+
+    // Wakes a sleeping stage once the other one moved a buffer or stopped
+    struct StageSignal {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::atomic<bool> isReaderDone{ false };
+        std::atomic<bool> isWriterDone{ false };
+
+        // Taking the lock first means a stage between its last check and its wait can't miss this
+        void notify() {
+            { std::lock_guard<std::mutex> lock(mutex); }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<Segment> segments;
+    std::vector<FileTotals> totals;
+
+    // Sort the segments by disk offset, or by file for sequential sinks, and merge neighbours closer than gapTolerance
+    std::vector<Read> coalesce(uint64_t gapTolerance, uint32_t sectorSize, bool isFileOrder);
+    // Reader stage: fill buffers from the pool in plan order and pass them on, every request
+    // holding a share of the scheduler's read budget
+    void readStage(SectorReader& reader, RecoveryScheduler& scheduler, uint32_t sectorSize, const std::vector<Read>& reads,
+        SpscRing<uint8_t*>& freeBuffers, SpscRing<ReadResult>& filledBuffers, StageSignal& signal, PipelineStats& stats);
+    // Hand the segments of a read to their files, skipping the ones that failed
+    void deliver(const Read& read, const ReadResult& result, OutputSink& outputs);
+
+public:
+    // Forget the previous plan and make room for fileCount output files
+    void reset(size_t fileCount);
+    // Queue the first dataLength bytes of a file. Extents are in file order, sparse ones only move the file offset
+    void addFile(uint32_t target, const std::vector<ClusterExtent>& extents, uint64_t dataLength, uint64_t bytesPerCluster,
+        const std::function<uint64_t(uint64_t)>& clusterToOffset);
+    // Read the plan in one sweep over the volume, or file by file when the sink is sequential. Reading and writing overlap: a reader thread fills
+    // pooled buffers while this thread writes them out. A failed request is retried one segment at
+    // a time and segments that still fail are left as holes
+    void execute(SectorReader& reader, RecoveryScheduler& scheduler, uint32_t sectorSize, uint64_t gapTolerance, OutputSink& outputs,
+        const std::function<void(uint64_t, uint64_t)>& onProgress);
+    const FileTotals& getTotals(uint32_t target) const { return totals[target]; }
+};
@@ -0,0 +1,99 @@
+#include "RecoveryScheduler.h"
+#include <omp.h>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <sstream>
+
+
+RecoveryScheduler::ReadSlot::ReadSlot(RecoveryScheduler& scheduler, uint64_t bytes)
+    : scheduler(scheduler)
+    , bytes(bytes) {
+    scheduler.acquire(bytes);
+}
+
+RecoveryScheduler::ReadSlot::~ReadSlot() {
+    scheduler.release(bytes);
+}
+
+RecoveryScheduler::RecoveryScheduler(uint32_t workerCount, uint32_t maxInFlightReads, uint64_t maxInFlightBytes)
+    : workerCount((std::max)(workerCount, 1u))
+    , maxInFlightReads((std::max)(maxInFlightReads, 1u))
+    , maxInFlightBytes(maxInFlightBytes) {}
+
+void RecoveryScheduler::acquire(uint64_t bytes) {
+    std::unique_lock<std::mutex> lock(budgetMutex);
+    budgetReleased.wait(lock, [this, bytes]() {
+        return inFlightReads < maxInFlightReads && (inFlightBytes == 0 || inFlightBytes + bytes <= maxInFlightBytes);
+    });
+    inFlightReads++;
+    inFlightBytes += bytes;
+}
+
+void RecoveryScheduler::release(uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(budgetMutex);
+        inFlightReads--;
+        inFlightBytes -= bytes;
+    }
+    budgetReleased.notify_all();
+}
+
+std::vector<RecoveryStatus> RecoveryScheduler::run(size_t jobCount, const Job& job) {
+    std::vector<RecoveryStatus> results(jobCount);
+    pendingOutput.assign(jobCount, std::wstring());
+    isFinished.assign(jobCount, false);
+    nextToPrint = 0;
+
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+    int64_t count = static_cast<int64_t>(jobCount);
+
+    // Exceptions can't leave an OpenMP region, the first one is kept and rethrown afterwards
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(workerCount)
+    for (int64_t i = 0; i < count; i++) {
+        std::wostringstream out;
+        try {
+            results[i] = job(static_cast<size_t>(i), static_cast<uint32_t>(omp_get_thread_num()), out);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!firstError) firstError = std::current_exception();
+        }
+        commitOutput(static_cast<size_t>(i), out.str());
+    }
+
+    if (firstError) std::rethrow_exception(firstError);
+    return results;
+}
+
+void RecoveryScheduler::commitOutput(size_t index, std::wstring output) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    pendingOutput[index] = std::move(output);
+    isFinished[index] = true;
+
+    while (nextToPrint < isFinished.size() && isFinished[nextToPrint]) {
+        std::wcout << pendingOutput[nextToPrint];
+        pendingOutput[nextToPrint].clear();
+        pendingOutput[nextToPrint].shrink_to_fit();
+        nextToPrint++;
+    }
+    std::wcout.flush();
+}
+
+void RecoveryScheduler::showSummary(const std::vector<RecoveryStatus>& results) {
+    size_t recoveredFiles = 0;
+    size_t corruptedFiles = 0;
+    uint64_t recoveredBytes = 0;
+    for (const RecoveryStatus& status : results) {
+        if (status.recoveredBytes > 0) recoveredFiles++;
+        if (status.isCorrupted) corruptedFiles++;
+        recoveredBytes += status.recoveredBytes;
+    }
+
+    std::cout << "[+] " << recoveredFiles << " / " << results.size() << " file(s) recovered, "
+        << recoveredBytes << " bytes written" << std::endl;
+    if (corruptedFiles > 0) {
+        std::cout << "[!] " << corruptedFiles << " file(s) show signs of corruption" << std::endl;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Structures.h"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Recovers many files at once. Jobs run on a fixed number of worker threads, every disk read of a job,
+// of the read planner's sweep and of the carving passes first takes a share of a global budget that
+// caps the requests and bytes in flight, and the console output of each job is buffered and printed
+// in submission order, so the log reads as if the files had been recovered one after another
+class RecoveryScheduler {
+public:
+    static constexpr uint32_t DEFAULT_WORKERS = 16;                          // Small files are latency-bound, not CPU-bound
+    static constexpr uint32_t DEFAULT_MAX_INFLIGHT_READS = 32;
+    static constexpr uint64_t DEFAULT_MAX_INFLIGHT_BYTES = 64ULL * 1024 * 1024;
+    static constexpr size_t STREAM_QUEUE_CAPACITY = 4096; // Files the scanner may run ahead while streaming
+    static constexpr size_t STREAM_BATCH_FILES = 256;     // Files recovered per sweep while streaming
+
+    // job(index, worker, out): worker is in [0, getWorkerCount()) and is never shared by two running jobs
+    using Job = std::function<RecoveryStatus(size_t, uint32_t, std::wostream&)>;
+
+    // Holds a share of the read budget for the lifetime of one request
+    class ReadSlot {
+    private:
+        RecoveryScheduler& scheduler;
+        uint64_t bytes;
+    public:
+        ReadSlot(RecoveryScheduler& scheduler, uint64_t bytes);
+        ~ReadSlot();
+        ReadSlot(const ReadSlot&) = delete;
+        ReadSlot& operator=(const ReadSlot&) = delete;
+    };
+
+    explicit RecoveryScheduler(uint32_t workerCount = DEFAULT_WORKERS,
+        uint32_t maxInFlightReads = DEFAULT_MAX_INFLIGHT_READS,
+        uint64_t maxInFlightBytes = DEFAULT_MAX_INFLIGHT_BYTES);
+
+    uint32_t getWorkerCount() const { return workerCount; }
+    // Run jobCount jobs and return their results in job order. The first exception thrown by
+    // a job is rethrown once every job has finished
+    std::vector<RecoveryStatus> run(size_t jobCount, const Job& job);
+    // Files recovered, bytes written and files flagged as corrupted, over all jobs of a run
+    static void showSummary(const std::vector<RecoveryStatus>& results);
+
+private:
+    uint32_t workerCount;
+    uint32_t maxInFlightReads;
+    uint64_t maxInFlightBytes;
+
+    // Read budget
+    std::mutex budgetMutex;
+    std::condition_variable budgetReleased;
+    uint32_t inFlightReads = 0;
+    uint64_t inFlightBytes = 0;
+
+    // Ordered output
+    std::mutex outputMutex;
+    std::vector<std::wstring> pendingOutput;
+    std::vector<bool> isFinished;
+    size_t nextToPrint = 0;
+
+    // Blocks until the request fits. A request larger than the byte cap still runs, but alone
+    void acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+    // Keep the output of a finished job and print every finished job up to the first running one
+    void commitOutput(size_t index, std::wstring output);
+};
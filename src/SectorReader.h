@@ -4,7 +4,10 @@
 
 class SectorReader {
 public:
+    // Reads may be issued from several threads at once
     virtual bool readSector(uint64_t sector, void* buffer, uint32_t size) = 0;
+    // Read sectorCount consecutive sectors of sectorSize bytes in a single request
+    virtual bool readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize) = 0;
     virtual uint32_t getBytesPerSector() = 0;
     virtual std::wstring getFilesystemType() = 0;
     virtual uint64_t getTotalMftRecords() = 0;
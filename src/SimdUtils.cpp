@@ -0,0 +1,92 @@
+#include "SimdUtils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SIMDUTILS_SSE2 1
+#endif
+
+namespace SimdUtils {
+
+bool isZeroBlock(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+#ifdef SIMDUTILS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    // Four vectors per iteration, OR them together and compare once
+    for (; offset + 64 <= size; offset += 64) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 32));
+        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 48));
+        __m128i combined = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(combined, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; offset < size; offset++) {
+        if (data[offset] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void utf16ToWide(const uint16_t* source, size_t maxLength, std::wstring& output) {
+    size_t length = 0;
+#ifdef SIMDUTILS_SSE2
+    // Skip eight characters at a time until a block holds a terminator, padding or control character
+    const __m128i controlLimit = _mm_set1_epi16(0x1F);
+    const __m128i padding = _mm_set1_epi16(-1);
+    for (; length + 8 <= maxLength; length += 8) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + length));
+        __m128i isControl = _mm_cmpeq_epi16(_mm_subs_epu16(chars, controlLimit), _mm_setzero_si128());
+        __m128i isPadding = _mm_cmpeq_epi16(chars, padding);
+        if (_mm_movemask_epi8(_mm_or_si128(isControl, isPadding)) != 0) {
+            break;
+        }
+    }
+#endif
+    bool hasControlChars = false;
+    size_t end = length;
+    for (; end < maxLength; end++) {
+        uint16_t c = source[end];
+        if (c == 0x0000 || c == 0xFFFF) break;
+        if (c < 0x20) hasControlChars = true;
+    }
+
+    output.clear();
+    if constexpr (sizeof(wchar_t) == sizeof(uint16_t)) {
+        if (!hasControlChars) {
+            output.assign(reinterpret_cast<const wchar_t*>(source), end);
+            return;
+        }
+    }
+    output.reserve(end);
+    for (size_t i = 0; i < end; i++) {
+        if (source[i] >= 0x20) output.push_back(static_cast<wchar_t>(source[i]));
+    }
+}
+
+size_t buildNonZeroSlotMask(const uint8_t* data, size_t size, std::vector<uint64_t>& slotMask) {
+    const size_t slotCount = size / DIRECTORY_SLOT_SIZE;
+    slotMask.assign((slotCount + 63) / 64, 0);
+    size_t nonZeroSlots = 0;
+
+    for (size_t slot = 0; slot < slotCount; slot++) {
+        const uint8_t* slotData = data + slot * DIRECTORY_SLOT_SIZE;
+#ifdef SIMDUTILS_SSE2
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slotData));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slotData + 16));
+        bool isEmpty = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(low, high), _mm_setzero_si128())) == 0xFFFF;
+#else
+        bool isEmpty = isZeroBlock(slotData, DIRECTORY_SLOT_SIZE);
+#endif
+        if (!isEmpty) {
+            slotMask[slot / 64] |= 1ULL << (slot % 64);
+            nonZeroSlots++;
+        }
+    }
+    return nonZeroSlots;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+// SSE2 helpers for scanning raw sector buffers, with scalar fallbacks for other targets
+namespace SimdUtils {
+    // Size of the fixed records scanned by buildNonZeroSlotMask (FAT32/exFAT directory entries)
+    constexpr size_t DIRECTORY_SLOT_SIZE = 32;
+
+    // True if every byte of the buffer is zero
+    bool isZeroBlock(const uint8_t* data, size_t size);
+
+    // Converts a UTF-16 name field up to its 0x0000/0xFFFF terminator, dropping control characters
+    void utf16ToWide(const uint16_t* source, size_t maxLength, std::wstring& output);
+
+    // Sets bit i of slotMask for every 32-byte slot i that contains a non-zero byte, returns the number of such slots
+    size_t buildNonZeroSlotMask(const uint8_t* data, size_t size, std::vector<uint64_t>& slotMask);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded single-producer single-consumer queue. Exactly one thread pushes and exactly one thread
+// pops, so head and tail each have a single writer and no lock is needed
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{ 0 }; // Next slot to pop, only written by the consumer
+    alignas(64) std::atomic<size_t> tail{ 0 }; // Next slot to push, only written by the producer
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Returns false if the ring is full, value is left untouched then
+    bool tryPush(T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) > mask) return false;
+        slots[currentTail & mask] = std::move(value);
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the ring is empty
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(slots[currentHead & mask]);
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+};
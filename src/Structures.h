@@ -8,17 +8,44 @@
 
 #pragma pack(push, 1)
 
-struct ClusterUsage {
-    uint64_t timestamp;  // When this cluster was used
-    uint32_t fileId;     // Identifier for the deleted file
-    bool isDeleted;      // Whether this usage was from a deleted file
-    uint64_t writeOffset; // Offset within the file where this cluster was used
+// Run of consecutive clusters
+struct ClusterExtent {
+    uint64_t start;   // First cluster
+    uint64_t length;  // Number of clusters
+    bool sparse;      // Not backed by any cluster, reads back as zeros
+};
+
+// Cluster range claimed by more than one file
+struct ClusterCollision {
+    uint64_t start;
+    uint64_t length;
+    std::vector<uint32_t> otherOwners; // IDs of the other files claiming the range
+};
+
+// Recovery and corruption analysis results, shared by all file systems
+struct RecoveryStatus {
+    bool isCorrupted;
+    bool hasFragmentedClusters;
+    double fragmentation;
+    bool hasBackJumps;
+    uint32_t backJumps;
+    bool hasRepeatedClusters;
+    uint32_t repeatedClusters;
+    bool hasLargeGaps;
+    uint32_t largeGaps;
+    bool hasOverwrittenClusters;
+    bool hasInvalidFileName;
+    bool hasInvalidExtension;
+    uint64_t expectedClusters;
+    uint64_t recoveredClusters;
+    uint64_t recoveredBytes;
+    std::vector<uint64_t> problematicClusters;
 };
 
 struct OverwriteAnalysis {
     bool hasOverwrite;
-    std::vector<uint32_t> overwrittenClusters;
-    std::map<uint32_t, std::vector<uint32_t>> overwrittenBy; // cluster -> list of file IDs that overwrote it
+    uint64_t overwrittenClusters;            // Clusters also claimed by another file
+    std::vector<ClusterCollision> collisions;
     double overwritePercentage;
 };
 
@@ -21,28 +21,37 @@ void Utils::ensureOutputDirectory() const {
     }
 }
 
-fs::path Utils::getOutputPath(const std::wstring& fullName, const std::wstring& folder) const {
-    //std::wstring fullName = fileName + L"." + extension;
-    fs::path outputPath = fs::path(folder) / fullName;
-
-    size_t dotPos = fullName.find_last_of(L".");
-    if (dotPos != std::wstring::npos && dotPos != 0) {
-        std::wstring fileName = fullName.substr(0, dotPos);
-        std::wstring extension = fullName.substr(dotPos + 1);
-
-        int counter = 1;
-        while (fs::exists(outputPath)) {
-            std::wstring newName = fileName + L"_" + std::to_wstring(counter);
-            if (!extension.empty() && extension != L"") {
-                newName += L"." + extension;
-            }
-            outputPath = fs::path(folder) / newName;
-            counter++;
-        }
+fs::path Utils::getOutputPath(const std::wstring& fullName, const fs::path& folder, bool isArchiveMember) const {
+    // Archive members only exist once written, the folder on disk says nothing about them
+    return outputNames.claim(folder, fullName, !isArchiveMember);
+}
+
+fs::path Utils::claimOutputPath(const std::wstring& fullName, const std::wstring& folder) const {
+    bool isArchiveMember = config.recover && config.outputSink != OutputSinkType::PLAIN_TYPE;
+    fs::path outputPath = getOutputPath(fullName, folder, isArchiveMember);
+    if (!config.recover) return outputPath;
+
+    if (!isArchiveMember) {
+        std::ofstream placeholder(outputPath, std::ios::binary);
     }
     return outputPath;
 }
 
+std::unique_ptr<ArchiveSink> Utils::openArchive() const {
+    if (!config.recover || config.outputSink == OutputSinkType::PLAIN_TYPE) return nullptr;
+    return std::make_unique<ArchiveSink>(config.sinkPath, config.outputSink, config.outputFolder);
+}
+
+void Utils::showSavedFile(const fs::path& outputPath, std::wostream& out) const {
+    if (config.outputSink != OutputSinkType::PLAIN_TYPE) {
+        out << "  [+] File stored in " << config.sinkPath << " as \"" << ArchiveSink::getMemberName(outputPath, config.outputFolder) << "\"" << std::endl;
+    }
+    else if (fs::exists(fs::absolute(outputPath))) {
+        out << "  [+] File saved to " << fs::absolute(outputPath) << L"\n";
+    }
+    else out << "  [-] Failed to save file" << std::endl;
+}
+
 void Utils::showProgress(uint64_t currentValue, uint64_t maxValue) const {
     float progress = static_cast<float>(currentValue) / maxValue * 100;
     std::cout << "\r[*] Progress: " << std::setw(5) << std::fixed << std::setprecision(2)
@@ -57,13 +66,13 @@ bool Utils::openLogFile() {
     }
     return logFile.is_open();
 }
-void Utils::logFileInfo(const uint16_t fileId, const std::wstring& fileName, const uint64_t fileSize) {
+void Utils::logFileInfo(const uint32_t fileId, const std::wstring& fileName, const uint64_t fileSize) {
     std::wcout << "[+] #" << fileId << " Found file \"" << fileName << "\"" << " (" << fileSize << " bytes)" << std::endl;
     if (config.createFileDataLog) {
         writeToLogFile(fileId, fileName, fileSize);
     }
 }
-void Utils::writeToLogFile(const uint16_t fileId, const std::wstring& fileName, const uint64_t fileSize) {
+void Utils::writeToLogFile(const uint32_t fileId, const std::wstring& fileName, const uint64_t fileSize) {
     if (logFile) {
         std::wstringstream ss;
         ss << L"#" << fileId << L" Filename: \"" << fileName << L"\" (" << fileSize << L" bytes)" << "\n";
@@ -109,6 +118,9 @@ void Utils::printFooter(char dividerChar, int width) const {
 void Utils::printItemDivider(char dividerChar, int width) const {
     std::cout << std::string(width, dividerChar) << "\n";
 }
+void Utils::printItemDivider(std::wostream& out, wchar_t dividerChar, int width) const {
+    out << std::wstring(width, dividerChar) << L"\n";
+}
 
 
 
@@ -1,9 +1,12 @@
 #pragma once
 #include "IConfigurable.h"
+#include "ArchiveSink.h"
+#include "NameRegistry.h"
 #include <filesystem>
 #include <cstdint>
 #include <string>
 #include <fstream>
+#include <memory>
 
 namespace fs = std::filesystem;
 
@@ -12,19 +15,27 @@ namespace fs = std::filesystem;
 class Utils : public IConfigurable{
 private:
     std::wofstream logFile;
+    mutable NameRegistry outputNames; // names handed out so far, per output folder
 public:
     Utils();
     ~Utils();
     
     // Creates output folder and log folder
     void ensureOutputDirectory() const;
-    fs::path getOutputPath(const std::wstring& fullName, const std::wstring& folder) const;
+    // Unique name in folder, "name_N.ext" if fullName is taken. Safe to call from several threads
+    fs::path getOutputPath(const std::wstring& fullName, const fs::path& folder, bool isArchiveMember = false) const;
+    // Pick a free output name and, when recovering, create the file at once so the name stays taken
+    fs::path claimOutputPath(const std::wstring& fullName, const std::wstring& folder) const;
+    // Archive named by --sink-path when --sink asks for one, null for plain files
+    std::unique_ptr<ArchiveSink> openArchive() const;
+    // Where a recovered file went, a plain file or a member of the archive
+    void showSavedFile(const fs::path& outputPath, std::wostream& out) const;
     void showProgress(uint64_t currentValue, uint64_t maxValue) const;
 
     /*=============== File Log Operations ===============*/
     bool openLogFile();
-    void logFileInfo(const uint16_t fileId, const std::wstring& fileName, const uint64_t fileSize);
-    void writeToLogFile(const uint16_t fileId, const std::wstring& fileName, const uint64_t fileSize);
+    void logFileInfo(const uint32_t fileId, const std::wstring& fileName, const uint64_t fileSize);
+    void writeToLogFile(const uint32_t fileId, const std::wstring& fileName, const uint64_t fileSize);
     bool confirmProceedWithoutLogFile() const;
     void closeLogFile();
 
@@ -32,4 +43,6 @@ public:
     void printHeader(const std::string& stage, char borderChar = '_', int width = 60) const;
     void printFooter(char dividerChar = '_', int width = 60) const;
     void printItemDivider(char dividerChar = '-', int width = 60) const;
+    // Same, into the buffered output of one recovery job
+    void printItemDivider(std::wostream& out, wchar_t dividerChar = L'-', int width = 60) const;
 };
\ No newline at end of file
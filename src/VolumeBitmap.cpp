@@ -0,0 +1,60 @@
+#include "VolumeBitmap.h"
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+
+void VolumeBitmap::assign(const std::vector<uint8_t>& bitmap, uint64_t clusterCount) {
+    uint64_t usableClusters = (std::min)(clusterCount, static_cast<uint64_t>(bitmap.size()) * 8);
+
+    words.assign(static_cast<size_t>((usableClusters + 63) / 64), 0);
+    std::memcpy(words.data(), bitmap.data(), static_cast<size_t>((usableClusters + 7) / 8));
+
+    // Mask the slack bits of the last word so they are never counted
+    if (usableClusters % 64 != 0) {
+        words.back() &= (1ULL << (usableClusters % 64)) - 1;
+    }
+    this->clusterCount = usableClusters;
+}
+
+bool VolumeBitmap::isAllocated(uint64_t cluster) const {
+    if (cluster >= clusterCount) return true;
+    return (words[static_cast<size_t>(cluster >> 6)] >> (cluster & 63)) & 1;
+}
+
+uint64_t VolumeBitmap::countAllocated(uint64_t start, uint64_t length, uint64_t* firstAllocated) const {
+    if (start >= clusterCount) {
+        if (firstAllocated && length) *firstAllocated = start;
+        return length;
+    }
+
+    uint64_t end = start + length;
+    uint64_t outside = 0;
+    if (end > clusterCount || end < start) {
+        outside = length - (clusterCount - start);
+        end = clusterCount;
+    }
+
+    uint64_t allocated = 0;
+    uint64_t cluster = start;
+    while (cluster < end) {
+        uint64_t offset = cluster & 63;
+        uint64_t count = (std::min)(64 - offset, end - cluster);
+        uint64_t mask = (count == 64) ? ~0ULL : (((1ULL << count) - 1) << offset);
+
+        uint64_t hits = words[static_cast<size_t>(cluster >> 6)] & mask;
+        if (hits && allocated == 0 && firstAllocated) {
+            *firstAllocated = cluster - offset + std::bitset<64>((hits & (~hits + 1)) - 1).count();
+        }
+        allocated += std::bitset<64>(hits).count();
+        cluster += count;
+    }
+    if (outside && allocated == 0 && firstAllocated) *firstAllocated = clusterCount;
+    return allocated + outside;
+}
+
+void VolumeBitmap::clear() {
+    words.clear();
+    words.shrink_to_fit();
+    clusterCount = 0;
+}
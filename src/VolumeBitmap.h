@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// In-memory copy of a volume allocation bitmap (NTFS $Bitmap), one bit per cluster with the
+// least significant bit first. Loaded once per scan so allocation checks never touch the disk
+class VolumeBitmap {
+private:
+    std::vector<uint64_t> words;
+    uint64_t clusterCount = 0;
+
+public:
+    // Take over the raw bitmap bytes, bits past clusterCount are ignored
+    void assign(const std::vector<uint8_t>& bitmap, uint64_t clusterCount);
+    bool isLoaded() const { return clusterCount != 0; }
+    bool isAllocated(uint64_t cluster) const;
+    // Number of allocated clusters in a run, counted a word at a time. Clusters past the end of
+    // the volume count as allocated since they cannot belong to a deleted file.
+    // firstAllocated, if given, receives the lowest of those clusters
+    uint64_t countAllocated(uint64_t start, uint64_t length, uint64_t* firstAllocated = nullptr) const;
+    void clear();
+};
@@ -1,12 +1,15 @@
 #include "SectorReader.h"
 #include "exFATRecovery.h"
+#include "SimdUtils.h"
 #include <cstdint>
 #include <memory>
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <future>
 #include <iostream>
 #include <set>
+#include <algorithm>
 
 exFATRecovery::exFATRecovery(const DriveType& driveType, std::unique_ptr<SectorReader> reader)
     : IConfigurable(), driveType(driveType) {
@@ -37,19 +40,23 @@ void exFATRecovery::printToolHeader() const {
 }
 
 // Helper functions for entry type checking
-inline bool exFATRecovery::IsDirectoryEntry(uint8_t entryType) {
+inline bool exFATRecovery::IsDirectoryEntry(uint8_t entryType) const {
     return (entryType & 0x7F) == 0x05;  // 0x85 with status bit masked
 }
 
-inline bool exFATRecovery::IsStreamExtensionEntry(uint8_t entryType) {
+inline bool exFATRecovery::IsStreamExtensionEntry(uint8_t entryType) const {
     return (entryType & 0x7F) == 0x40;  // 0xC0 with status bit masked
 }
 
-inline bool exFATRecovery::IsFileNameEntry(uint8_t entryType) {
+inline bool exFATRecovery::IsFileNameEntry(uint8_t entryType) const {
     return (entryType & 0x7F) == 0x41;  // 0xC1 with status bit masked
 }
 
-inline bool exFATRecovery::IsEntryInUse(uint8_t entryType) {
+inline bool exFATRecovery::IsSecondaryEntry(uint8_t entryType) const {
+    return (entryType & 0x40) != 0;  // TypeCategory bit, stream/name/vendor entries
+}
+
+inline bool exFATRecovery::IsEntryInUse(uint8_t entryType) const {
     return (entryType & 0x80) != 0;  // Check if in-use bit is set
 }
 
@@ -65,6 +72,10 @@ bool exFATRecovery::readSector(uint64_t sector, void* buffer, uint32_t size) {
     return sectorReader && sectorReader->readSector(sector, buffer, size);
 }
 
+bool exFATRecovery::readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize) {
+    return sectorReader && sectorReader->readSectors(sector, sectorCount, buffer, sectorSize);
+}
+
 void exFATRecovery::readBootSector(uint32_t sector) {
     uint32_t bytesPerSector = getBytesPerSector();
     std::vector<uint8_t> buffer(bytesPerSector);
@@ -81,6 +92,7 @@ void exFATRecovery::readBootSector(uint32_t sector) {
 
     driveInfo.bytesPerSector = 1 << driveInfo.bootSector.BytesPerSectorShift;
     driveInfo.sectorsPerCluster = 1 << driveInfo.bootSector.SectorsPerClusterShift;
+    workerClusters.assign(scheduler.getWorkerCount(), ClusterBitset(static_cast<uint64_t>(driveInfo.bootSector.ClusterCount) + MIN_DATA_CLUSTER));
 
     /*driveInfo.fatOffset = driveInfo.bootSector.FatOffset;
     driveInfo.clusterHeapOffset = driveInfo.bootSector.ClusterHeapOffset;
@@ -132,32 +144,29 @@ bool exFATRecovery::isValidCluster(uint32_t cluster) const {
 }
 
 /* Cluster operations*/
-uint32_t exFATRecovery::clusterToSector(uint32_t cluster) {
+uint64_t exFATRecovery::clusterToSector(uint32_t cluster) {
     // Convert the cluster number to a sector number using the Cluster Heap Offset
-    return driveInfo.bootSector.ClusterHeapOffset + ((cluster - 2) * driveInfo.sectorsPerCluster);
+    return driveInfo.bootSector.ClusterHeapOffset + (static_cast<uint64_t>(cluster - 2) * driveInfo.sectorsPerCluster);
 }
 uint32_t exFATRecovery::getNextCluster(uint32_t cluster) {
-    uint32_t fatOffset = cluster * 4;
-    uint32_t fatSector = driveInfo.bootSector.ClusterHeapOffset + (fatOffset / driveInfo.bytesPerSector);
+    uint64_t fatOffset = static_cast<uint64_t>(cluster) * 4;
+    uint64_t fatSector = driveInfo.bootSector.FatOffset + (fatOffset / driveInfo.bytesPerSector);
     uint32_t entryOffset = fatOffset % driveInfo.bytesPerSector;
 
     std::vector<uint8_t> sectorBuffer(driveInfo.bytesPerSector);
     if (!readSector(fatSector, sectorBuffer.data(), driveInfo.bytesPerSector)) {
         std::cerr << "Error: Failed to read FAT sector " << fatSector << std::endl;
-        return 0xFFFFFFFF;
+        return END_OF_CHAIN;
     }
     
-    uint32_t fatEntry = *reinterpret_cast<uint32_t*>(sectorBuffer.data() + entryOffset);
-    uint32_t nextCluster = fatEntry & 0x0FFFFFFF;  // Mask the lower 28 bits
+    uint32_t nextCluster = *reinterpret_cast<uint32_t*>(sectorBuffer.data() + entryOffset);
 
-        // Check for special cluster values
-    if (nextCluster >= 0x0FFFFFF8) {
-        if (nextCluster == 0x0FFFFFFF) {
-            return 0xFFFFFFFF;  // End of cluster chain
-        }
-        else {
-            return 0xFFFFFFF7;  // Bad cluster
-        }
+    // exFAT FAT entries use all 32 bits
+    if (nextCluster >= 0xFFFFFFF8) {
+        return END_OF_CHAIN;  // End of cluster chain
+    }
+    if (nextCluster == BAD_CLUSTER) {
+        return BAD_CLUSTER;
     }
 
     return nextCluster;
@@ -166,16 +175,19 @@ uint32_t exFATRecovery::getNextCluster(uint32_t cluster) {
 /* File scan */
 void exFATRecovery::scanForDeletedFiles() {
     utils.printHeader("File Search:");
-    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
-        std::cout << "Exitting..." << std::endl;
-        exit(1);
-    }
+    loadUpcaseTable();
     scanDirectory(driveInfo.bootSector.RootDirectoryCluster);
+    if (config.carve) {
+        carveOrphanedDirectories();
+    }
+    if (rejectedEntrySets > 0) {
+        std::cout << "[*] Skipped " << rejectedEntrySets << " deleted entry set(s) with invalid checksum or name hash" << std::endl;
+    }
     utils.closeLogFile();
     utils.printFooter();
 }
 
-void exFATRecovery::scanDirectory(uint32_t cluster, uint32_t depth) {
+void exFATRecovery::scanDirectory(uint32_t cluster, uint64_t dataLength, bool noFatChain, bool isDeleted, uint32_t depth) {
     try {
         
         if (depth >= MAX_RECURSION_DEPTH) {
@@ -188,94 +200,281 @@ void exFATRecovery::scanDirectory(uint32_t cluster, uint32_t depth) {
             return;
         }
 
-        uint64_t sector = clusterToSector(cluster);
-        uint32_t entriesPerSector = driveInfo.bytesPerSector / sizeof(DirectoryEntryCommon);
-        uint64_t maxSectorCount = static_cast<uint64_t>(driveInfo.bootSector.ClusterCount) * static_cast<uint64_t>(driveInfo.sectorsPerCluster);
-        //sectorBuffer.resize(bytesPerSector);
-        std::vector<uint8_t> sectorBuffer(driveInfo.bytesPerSector);
-        for (uint32_t i = 0; i < driveInfo.sectorsPerCluster; i++) {
-            uint64_t currentSector = sector + static_cast<uint64_t>(i);
-           
-            if (currentSector >= maxSectorCount) {
-                std::cerr << "[!] Sector number exceeds device bounds: " << currentSector << std::endl;
-                continue;
-            }
-
-            if (!readSector(currentSector, sectorBuffer.data(), driveInfo.bytesPerSector)) {
-                std::cerr << "[!] Failed to read sector: " << currentSector << std::endl;
-                continue;
-            }
-            processEntriesInSector(entriesPerSector, sectorBuffer);
+        // Each directory is scanned once, garbage entries can point back up the tree
+        if (!scannedDirectories.insert(cluster).second) {
+            return;
         }
 
-        uint32_t nextCluster = getNextCluster(cluster);
-        if (isValidCluster(nextCluster) && nextCluster != cluster) {
-            scanDirectory(nextCluster, depth + 1);
+        std::vector<uint8_t> dirStream;
+        std::vector<uint32_t> streamClusters;
+        if (!readDirectoryStream(cluster, dataLength, noFatChain, dirStream, &streamClusters)) {
+            return;
         }
+        // Carving must not pick up the later clusters of a directory again
+        scannedDirectories.insert(streamClusters.begin(), streamClusters.end());
+        processDirectoryStream(dirStream, isDeleted, depth);
     }
     catch (const std::exception& e) {
         std::cerr << "[-] Error in scanDirectory " << e.what() << std::endl;
     }
 }
 
-void exFATRecovery::processEntriesInSector(uint32_t entriesPerSector, const std::vector<uint8_t>& sectorBuffer) {
-    exFATDirEntryData dirData{};
+// Reads the complete directory, following either the FAT chain or the contiguous NoFatChain extent
+bool exFATRecovery::readDirectoryStream(uint32_t cluster, uint64_t dataLength, bool noFatChain, std::vector<uint8_t>& dirStream, std::vector<uint32_t>* streamClusters) {
+    uint64_t bytesPerCluster = static_cast<uint64_t>(driveInfo.sectorsPerCluster) * driveInfo.bytesPerSector;
+    uint64_t maxLength = (dataLength != 0) ? (std::min)(dataLength, MAX_DIRECTORY_SIZE) : MAX_DIRECTORY_SIZE;
+    uint64_t maxClusters = (maxLength + bytesPerCluster - 1) / bytesPerCluster;
+
+    // Resolve the cluster list first so that adjacent clusters are read together
+    std::vector<uint32_t> clusters;
+    if (noFatChain) {
+        for (uint64_t i = 0; i < maxClusters && isValidCluster(static_cast<uint32_t>(cluster + i)); i++) {
+            clusters.push_back(static_cast<uint32_t>(cluster + i));
+        }
+    }
+    else {
+        std::unordered_set<uint32_t> chainClusters;
+        uint32_t currentCluster = cluster;
+        while (clusters.size() < maxClusters && isValidCluster(currentCluster) && chainClusters.insert(currentCluster).second) {
+            clusters.push_back(currentCluster);
+            currentCluster = getNextCluster(currentCluster);
+        }
+    }
+
+    if (clusters.empty()) {
+        return false;
+    }
+    if (streamClusters) *streamClusters = clusters;
+
+    dirStream.assign(clusters.size() * bytesPerCluster, 0);
+    uint32_t maxClustersPerRead = static_cast<uint32_t>((std::max)(static_cast<uint64_t>(1), MAX_READ_BLOCK_SIZE / bytesPerCluster));
+
+    size_t index = 0;
+    while (index < clusters.size()) {
+        uint32_t runLength = 1;
+        while (runLength < maxClustersPerRead && index + runLength < clusters.size() &&
+            clusters[index + runLength] == clusters[index] + runLength) {
+            runLength++;
+        }
+
+        // A failed read leaves zeros behind, which the parser treats as end of directory
+        if (!readSectors(clusterToSector(clusters[index]), runLength * driveInfo.sectorsPerCluster,
+            dirStream.data() + index * bytesPerCluster, driveInfo.bytesPerSector)) {
+            std::cerr << "[!] Failed to read directory cluster 0x" << std::hex << clusters[index] << std::dec << std::endl;
+        }
+        index += runLength;
+    }
+    return true;
+}
 
-    for (uint32_t j = 0; j < entriesPerSector; j++) {
-        if ((static_cast<uint64_t>(j) + 1) * sizeof(DirectoryEntryCommon) > sectorBuffer.size()) {
-            std::cerr << "Buffer overflow prevented in processEntriesInSector " << j << std::endl;
+// Parses the directory as one continuous sequence of 32-byte entries, so entry sets may span sectors and clusters
+void exFATRecovery::processDirectoryStream(const std::vector<uint8_t>& dirStream, bool isDeletedDirectory, uint32_t depth) {
+    const DirectoryEntryCommon* entries = reinterpret_cast<const DirectoryEntryCommon*>(dirStream.data());
+    const size_t entryCount = dirStream.size() / sizeof(DirectoryEntryCommon);
+
+    size_t index = 0;
+    while (index < entryCount) {
+        uint8_t entryType = entries[index].EntryType;
+        if (entryType == 0x00) { // End of directory
+            if (config.deepScan) {
+                scanDirectorySlack(dirStream, index, depth);
+            }
             break;
         }
 
-        const DirectoryEntryCommon* entry = reinterpret_cast<const DirectoryEntryCommon*>(sectorBuffer.data() + j * sizeof(DirectoryEntryCommon));
-        uint8_t entryType = entry->EntryType;
+        if (!IsDirectoryEntry(entryType)) {
+            index++;
+            continue;
+        }
+
+        index = processEntrySet(entries, index, entryCount, isDeletedDirectory, depth);
+    }
+}
+
+// Parses the entry set starting at index and returns the index of the first entry after it
+size_t exFATRecovery::processEntrySet(const DirectoryEntryCommon* entries, size_t index, size_t entryCount, bool forceDeleted, uint32_t depth) {
+    // File entry followed by SecondaryCount stream extension and file name entries
+    const DirectoryEntryExFAT* fileEntry = reinterpret_cast<const DirectoryEntryExFAT*>(&entries[index]);
+    size_t setEnd = (std::min)(entryCount, index + 1 + fileEntry->SecondaryCount);
 
-        if (IsDirectoryEntry(entryType) && dirData.inFileEntry) {
-            finalizeDirectoryEntry(dirData);
+    // Deleted entry sets are checked before use, reused directory clusters are full of garbage
+    if ((forceDeleted || !IsEntryInUse(entries[index].EntryType)) && !isValidEntrySet(&entries[index], setEnd - index)) {
+        rejectedEntrySets++;
+        return index + 1;
+    }
+
+    exFATDirEntryData dirData{};
+    size_t current = index;
+    for (; current < setEnd; current++) {
+        if (current > index && !IsSecondaryEntry(entries[current].EntryType)) {
+            break; // Entry set was cut short, resume parsing at the interrupting entry
         }
 
         try {
-            processDirectoryEntry(entry, dirData);
+            processDirectoryEntry(&entries[current], dirData);
         }
         catch (const std::exception& e) {
             std::cerr << "Error processing directory entry: " << e.what() << std::endl;
             dirData = {};
-            continue;
+            break;
         }
     }
-    if (dirData.inFileEntry) {
-        finalizeDirectoryEntry(dirData);
+
+    // Anything inside a deleted directory is gone as well, even if its entries still look in use
+    dirData.isDeleted = dirData.isDeleted || forceDeleted;
+    finalizeDirectoryEntry(dirData, depth);
+    return (std::max)(current, index + 1);
+}
+
+// Deep scan: look for complete entry sets between the end-of-directory marker and the end of the stream
+void exFATRecovery::scanDirectorySlack(const std::vector<uint8_t>& dirStream, size_t firstEntry, uint32_t depth) {
+    const DirectoryEntryCommon* entries = reinterpret_cast<const DirectoryEntryCommon*>(dirStream.data());
+    const size_t entryCount = dirStream.size() / sizeof(DirectoryEntryCommon);
+    if (firstEntry >= entryCount) return;
+
+    // Slack is mostly zeros, the SIMD pre-filter leaves only the slots that hold anything
+    std::vector<uint64_t> slotMask;
+    const uint8_t* slackData = dirStream.data() + firstEntry * sizeof(DirectoryEntryCommon);
+    if (SimdUtils::buildNonZeroSlotMask(slackData, (entryCount - firstEntry) * sizeof(DirectoryEntryCommon), slotMask) == 0) {
+        return;
+    }
+
+    size_t nextIndex = firstEntry;
+    for (size_t word = 0; word < slotMask.size(); word++) {
+        uint64_t bits = slotMask[word];
+        while (bits) {
+            uint32_t bit = 0;
+            while (!(bits & (1ULL << bit))) bit++;
+            bits &= bits - 1;
+
+            size_t index = firstEntry + word * 64 + bit;
+            if (index < nextIndex || !IsDirectoryEntry(entries[index].EntryType)) continue;
+
+            // Every set found here is treated as deleted and has to pass the checksum and name hash checks
+            nextIndex = processEntrySet(entries, index, entryCount, true, depth);
+        }
     }
 }
 
-void exFATRecovery::processDirectoryEntry(const DirectoryEntryCommon* entry, exFATDirEntryData& dirData) {
-    uint8_t entryType = entry->EntryType;
+void exFATRecovery::carveOrphanedDirectories() {
+    uint32_t bytesPerCluster = driveInfo.sectorsPerCluster * driveInfo.bytesPerSector;
+    uint32_t clustersPerBlock = (std::max)(1u, CARVE_READ_BLOCK_SIZE / bytesPerCluster);
+    uint32_t clusterCount = driveInfo.bootSector.ClusterCount - MIN_DATA_CLUSTER + 1;
+    int64_t blockCount = (static_cast<int64_t>(clusterCount) + clustersPerBlock - 1) / clustersPerBlock;
+
+    std::cout << "[*] Carving " << clusterCount << " clusters for orphaned directories..." << std::endl;
+
+    // Every thread sweeps its own blocks with its own buffer, results are merged at the end
+    std::vector<uint32_t> candidates;
+    #pragma omp parallel
+    {
+        std::vector<uint8_t> block(static_cast<size_t>(clustersPerBlock) * bytesPerCluster);
+        std::vector<uint32_t> localCandidates;
+
+        #pragma omp for schedule(dynamic)
+        for (int64_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+            uint32_t firstCluster = MIN_DATA_CLUSTER + static_cast<uint32_t>(blockIndex) * clustersPerBlock;
+            uint32_t count = (std::min)(clustersPerBlock, driveInfo.bootSector.ClusterCount - firstCluster + 1);
+            RecoveryScheduler::ReadSlot slot(scheduler, block.size());
+
+            if (readSectors(clusterToSector(firstCluster), count * driveInfo.sectorsPerCluster, block.data(), driveInfo.bytesPerSector)) {
+                for (uint32_t i = 0; i < count; i++) {
+                    if (isDirectoryCluster(block.data() + static_cast<size_t>(i) * bytesPerCluster, bytesPerCluster)) {
+                        localCandidates.push_back(firstCluster + i);
+                    }
+                }
+                continue;
+            }
+
+            // Fall back to single clusters so one bad sector doesn't hide the whole block
+            for (uint32_t i = 0; i < count; i++) {
+                if (readSectors(clusterToSector(firstCluster + i), driveInfo.sectorsPerCluster, block.data(), driveInfo.bytesPerSector) &&
+                    isDirectoryCluster(block.data(), bytesPerCluster)) {
+                    localCandidates.push_back(firstCluster + i);
+                }
+            }
+        }
+
+        #pragma omp critical
+        candidates.insert(candidates.end(), localCandidates.begin(), localCandidates.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
 
-    if (!IsEntryInUse(entryType)) {
-        dirData.isDeleted = true;
-        if (IsFileNameEntry(entryType)) {
-            const FileNameEntry* fnEntry = reinterpret_cast<const FileNameEntry*>(entry);
-            dirData.longFilename += extractFileName(fnEntry);
-            dirData.inFileEntry = true;
+    // Adjacent orphaned clusters are parsed as one contiguous stream so entry sets may span them.
+    // Every live directory was reached from the root, so whatever is left over is deleted
+    uint32_t orphanCount = 0;
+    size_t index = 0;
+    while (index < candidates.size()) {
+        if (scannedDirectories.count(candidates[index])) {
+            index++;
+            continue;
         }
-        else if (IsStreamExtensionEntry(entryType)) {
-            const StreamExtensionEntry* streamEntry = reinterpret_cast<const StreamExtensionEntry*>(entry);
-            dirData.startingCluster = streamEntry->FirstCluster;
-            dirData.fileSize = streamEntry->DataLength;
+
+        size_t runLength = 1;
+        while (index + runLength < candidates.size() &&
+            candidates[index + runLength] == candidates[index] + runLength &&
+            !scannedDirectories.count(candidates[index + runLength])) {
+            runLength++;
         }
-        else if (IsDirectoryEntry(entryType)) {
-            const DirectoryEntryExFAT* dirEntry = reinterpret_cast<const DirectoryEntryExFAT*>(entry);
-            dirData.isDirectory = (dirEntry->FileAttributes & 0x10) != 0;
+
+        orphanCount += static_cast<uint32_t>(runLength);
+        scanDirectory(candidates[index], runLength * bytesPerCluster, true, true);
+        index += runLength;
+    }
+
+    std::cout << "[+] Found " << orphanCount << " orphaned directory cluster(s)" << std::endl;
+}
+
+bool exFATRecovery::isDirectoryCluster(const uint8_t* clusterData, uint32_t bytesPerCluster) const {
+    const DirectoryEntryCommon* entries = reinterpret_cast<const DirectoryEntryCommon*>(clusterData);
+    size_t entryCount = bytesPerCluster / sizeof(DirectoryEntryCommon);
+
+    // One complete entry set with a matching checksum and name hash is enough, random data won't pass both
+    for (size_t i = 0; i < entryCount; i++) {
+        if (!IsDirectoryEntry(entries[i].EntryType)) continue;
+
+        const DirectoryEntryExFAT* fileEntry = reinterpret_cast<const DirectoryEntryExFAT*>(&entries[i]);
+        size_t setLength = static_cast<size_t>(fileEntry->SecondaryCount) + 1;
+        if (i + setLength <= entryCount && isValidEntrySet(&entries[i], setLength)) {
+            return true;
         }
     }
+    return false;
 }
 
-void exFATRecovery::finalizeDirectoryEntry(exFATDirEntryData& dirData) {
+void exFATRecovery::processDirectoryEntry(const DirectoryEntryCommon* entry, exFATDirEntryData& dirData) {
+    uint8_t entryType = entry->EntryType;
+
+    if (IsFileNameEntry(entryType)) {
+        const FileNameEntry* fnEntry = reinterpret_cast<const FileNameEntry*>(entry);
+        dirData.longFilename += extractFileName(fnEntry);
+    }
+    else if (IsStreamExtensionEntry(entryType)) {
+        const StreamExtensionEntry* streamEntry = reinterpret_cast<const StreamExtensionEntry*>(entry);
+        dirData.startingCluster = streamEntry->FirstCluster;
+        dirData.fileSize = streamEntry->DataLength;
+        dirData.validDataLength = (std::min)(streamEntry->ValidDataLength, streamEntry->DataLength);
+        dirData.nameLength = streamEntry->NameLength;
+        dirData.noFatChain = (streamEntry->GeneralFlags & NO_FAT_CHAIN_FLAG) != 0;
+    }
+    else if (IsDirectoryEntry(entryType)) {
+        const DirectoryEntryExFAT* dirEntry = reinterpret_cast<const DirectoryEntryExFAT*>(entry);
+        dirData.isDirectory = (dirEntry->FileAttributes & 0x10) != 0;
+        dirData.isDeleted = !IsEntryInUse(entryType);
+        dirData.inFileEntry = true;
+    }
+}
+
+void exFATRecovery::finalizeDirectoryEntry(exFATDirEntryData& dirData, uint32_t depth) {
+    if (dirData.nameLength != 0 && dirData.longFilename.size() > dirData.nameLength) {
+        dirData.longFilename.resize(dirData.nameLength);
+    }
+
     if (dirData.inFileEntry && !dirData.longFilename.empty() && dirData.startingCluster > 0) {
         if (isValidDeletedEntry(dirData.startingCluster, dirData.fileSize)) {
             try {
                 if (dirData.isDirectory) {
-                    scanDirectory(dirData.startingCluster, currentRecursionDepth + 1);
+                    scanDirectory(dirData.startingCluster, dirData.fileSize, dirData.noFatChain, dirData.isDeleted, depth + 1);
                 }
                 else if (dirData.isDeleted) {
                     exFATFileInfo fileInfo = parseFileInfo(dirData);
@@ -289,7 +488,134 @@ void exFATRecovery::finalizeDirectoryEntry(exFATDirEntryData& dirData) {
             }
         }
     }
-    dirData = {};
+}
+
+// Loads the volume up-case table referenced from the root directory, used for name hash validation
+void exFATRecovery::loadUpcaseTable() {
+    // Fallback when the table can't be read, matches the ASCII range of the default table
+    upcaseTable.resize(0x10000);
+    for (uint32_t i = 0; i < 0x10000; i++) {
+        upcaseTable[i] = static_cast<uint16_t>((i >= 'a' && i <= 'z') ? i - 0x20 : i);
+    }
+
+    std::vector<uint8_t> rootStream;
+    if (!readDirectoryStream(driveInfo.bootSector.RootDirectoryCluster, 0, false, rootStream)) {
+        std::cerr << "[!] Failed to read root directory, using default up-case table" << std::endl;
+        return;
+    }
+
+    const UpcaseTableEntry* tableEntry = nullptr;
+    for (size_t offset = 0; offset + sizeof(UpcaseTableEntry) <= rootStream.size(); offset += sizeof(UpcaseTableEntry)) {
+        const UpcaseTableEntry* entry = reinterpret_cast<const UpcaseTableEntry*>(rootStream.data() + offset);
+        if (entry->EntryType == 0x00) break;
+        if (entry->EntryType == UPCASE_TABLE_ENTRY) {
+            tableEntry = entry;
+            break;
+        }
+    }
+
+    if (!tableEntry || tableEntry->DataLength == 0 || tableEntry->DataLength > 0x20000) {
+        std::cerr << "[!] Up-case table not found, using default up-case table" << std::endl;
+        return;
+    }
+
+    std::vector<uint8_t> tableData;
+    if (!readDirectoryStream(tableEntry->FirstCluster, tableEntry->DataLength, false, tableData)) {
+        std::cerr << "[!] Failed to read up-case table, using default up-case table" << std::endl;
+        return;
+    }
+    tableData.resize(tableEntry->DataLength);
+
+    uint32_t checksum = 0;
+    for (uint8_t byte : tableData) {
+        checksum = ((checksum & 1) ? 0x80000000 : 0) + (checksum >> 1) + byte;
+    }
+    if (checksum != tableEntry->TableChecksum) {
+        std::cerr << "[!] Up-case table checksum mismatch, using default up-case table" << std::endl;
+        return;
+    }
+
+    // Compressed form: 0xFFFF followed by a count stands for that many identity mappings
+    const uint16_t* compressed = reinterpret_cast<const uint16_t*>(tableData.data());
+    size_t compressedLength = tableData.size() / 2;
+    uint32_t character = 0;
+    for (size_t i = 0; i < compressedLength && character < 0x10000; i++) {
+        if (compressed[i] == 0xFFFF && i + 1 < compressedLength) {
+            character += compressed[++i];
+            continue;
+        }
+        upcaseTable[character++] = compressed[i];
+    }
+}
+
+// Validates a deleted entry set against its SetChecksum, NameLength and NameHash fields
+bool exFATRecovery::isValidEntrySet(const DirectoryEntryCommon* entrySet, size_t entryCount) const {
+    const DirectoryEntryExFAT* fileEntry = reinterpret_cast<const DirectoryEntryExFAT*>(entrySet);
+
+    // A file needs at least the stream extension and one file name entry
+    if (fileEntry->SecondaryCount < 2 || entryCount != static_cast<size_t>(fileEntry->SecondaryCount) + 1) {
+        return false;
+    }
+    if (!IsStreamExtensionEntry(entrySet[1].EntryType)) {
+        return false;
+    }
+
+    if (computeSetChecksum(entrySet, entryCount) != fileEntry->SetChecksum) {
+        return false;
+    }
+
+    const StreamExtensionEntry* streamEntry = reinterpret_cast<const StreamExtensionEntry*>(&entrySet[1]);
+    uint32_t nameLength = streamEntry->NameLength;
+    uint32_t nameEntries = (nameLength + NAME_CHARS_PER_ENTRY - 1) / NAME_CHARS_PER_ENTRY;
+    if (nameLength == 0 || 2 + nameEntries > entryCount) {
+        return false;
+    }
+
+    uint16_t name[255 + NAME_CHARS_PER_ENTRY];
+    for (uint32_t i = 0; i < nameEntries; i++) {
+        if (!IsFileNameEntry(entrySet[2 + i].EntryType)) {
+            return false;
+        }
+        const FileNameEntry* fnEntry = reinterpret_cast<const FileNameEntry*>(&entrySet[2 + i]);
+        memcpy(name + i * NAME_CHARS_PER_ENTRY, fnEntry->FileName, sizeof(fnEntry->FileName));
+    }
+
+    return computeNameHash(name, nameLength) == streamEntry->NameHash;
+}
+
+// EntrySetChecksum from the exFAT specification. Each step depends on the previous one, so instead of
+// vectorizing, the loop runs unrolled over whole entries and only the first entry skips the checksum field
+uint16_t exFATRecovery::computeSetChecksum(const DirectoryEntryCommon* entrySet, size_t entryCount) const {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(entrySet);
+    constexpr size_t entrySize = sizeof(DirectoryEntryCommon);
+    uint16_t checksum = 0;
+
+    for (size_t entry = 0; entry < entryCount; entry++) {
+        const uint8_t* data = bytes + entry * entrySize;
+
+        // Deletion only clears the in-use bit of each EntryType, the checksum was computed with it set
+        checksum = static_cast<uint16_t>(((checksum & 1) ? 0x8000 : 0) + (checksum >> 1) + (data[0] | 0x80));
+        size_t i = 1;
+        if (entry == 0) {
+            checksum = static_cast<uint16_t>(((checksum & 1) ? 0x8000 : 0) + (checksum >> 1) + data[1]);
+            i = 4; // Skip SetChecksum
+        }
+        for (; i < entrySize; i++) {
+            checksum = static_cast<uint16_t>(((checksum & 1) ? 0x8000 : 0) + (checksum >> 1) + data[i]);
+        }
+    }
+    return checksum;
+}
+
+// NameHash over the up-cased name, low byte first
+uint16_t exFATRecovery::computeNameHash(const uint16_t* name, uint32_t nameLength) const {
+    uint16_t hash = 0;
+    for (uint32_t i = 0; i < nameLength; i++) {
+        uint16_t character = upcaseTable[name[i]];
+        hash = static_cast<uint16_t>(((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (character & 0xFF));
+        hash = static_cast<uint16_t>(((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (character >> 8));
+    }
+    return hash;
 }
 
 exFATFileInfo exFATRecovery::parseFileInfo(const exFATDirEntryData& dirData) {
@@ -297,7 +623,9 @@ exFATFileInfo exFATRecovery::parseFileInfo(const exFATDirEntryData& dirData) {
     fileInfo.fileId = this->fileId;
     fileInfo.fileName = dirData.longFilename;
     fileInfo.fileSize = dirData.fileSize;
+    fileInfo.validDataLength = dirData.validDataLength;
     fileInfo.cluster = dirData.startingCluster;
+    fileInfo.noFatChain = dirData.noFatChain;
     ++this->fileId;
     return fileInfo;
 }
@@ -314,7 +642,9 @@ std::wstring exFATRecovery::extractFileName(const FileNameEntry* fnEntry) const
 
 void exFATRecovery::addToRecoveryList(const exFATFileInfo& fileInfo) {
     if (config.recover || config.analyze) {
-        recoveryList.push_back(fileInfo);
+        // While streaming the recovery stage owns the files, nothing is kept for a later selection
+        if (streamQueue) streamQueue->push(fileInfo);
+        else recoveryList.push_back(fileInfo);
     }
 }
 
@@ -326,126 +656,21 @@ bool exFATRecovery::isClusterInUse(uint32_t cluster) {
     uint32_t fatValue = getNextCluster(cluster);
     return (fatValue != 0 && fatValue != 0xF8FFFFFF);
 }
-// Analyzes clusters for repetition, gaps, backward jumps and calculates the fragmentation score
-void exFATRecovery::analyzeClusterPattern(const std::vector<uint32_t>& clusters, exFATRecoveryStatus& status) const {
-    //ClusterAnalysisResult result = { 0.0, false, 0, 0, 0 };
-
-    if (clusters.size() < MINIMUM_CLUSTERS_FOR_ANALYSIS) {
-        return; // Too few clusters to make reliable assessment
-    }
-
-    uint32_t totalAnomalies = 0;
-    double avgGapSize = 0;
-    uint32_t gapCount = 0;
-
-    for (size_t i = 1; i < clusters.size(); i++) {
-        uint32_t gap = 0;
-
-        // Check for repeated clusters
-        if (clusters[i] == clusters[i - 1]) {
-            //status.isCorrupted = true;
-            status.repeatedClusters++;
-            totalAnomalies++;
-            continue;
-        }
-
-        // Calculate gap or detect backward jump
-        if (clusters[i] > clusters[i - 1]) {
-            gap = clusters[i] - clusters[i - 1] - 1;
-        }
-        else {
-            //status.isCorrupted = true;
-            status.backJumps++;
-            totalAnomalies++;
-            continue;
-        }
-
-        // Analyze gaps
-        if (gap > 0) {
-            avgGapSize += gap;
-            gapCount++;
-
-            if (gap >= LARGE_GAP_THRESHOLD) {
-                //status.isCorrupted = true;
-                status.largeGaps++;
-                totalAnomalies++;
-            }
-        }
-    }
-
-    // Calculate average gap size if gaps exist
-    if (gapCount > 0) {
-        avgGapSize /= gapCount;
-    }
-
-    // Calculate overall fragmentation score (0.0 - 1.0)
-    double totalPairs = clusters.size() - 1.0;
-    status.fragmentation = (std::min)(1.0, static_cast<double>(totalAnomalies) / totalPairs);
-
-    status.hasLargeGaps = (status.largeGaps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
-    status.hasBackJumps = (status.backJumps > totalPairs * SUSPICIOUS_PATTERN_THRESHOLD);
-    status.hasFragmentedClusters = (status.fragmentation > SEVERE_PATTERN_THRESHOLD);
-    status.hasRepeatedClusters = (status.repeatedClusters > 0);
-
-    if (status.hasBackJumps || status.hasFragmentedClusters || status.hasLargeGaps || status.hasRepeatedClusters) status.isCorrupted = true;
-
-}
-// Checks if a filename is corrupted
-bool exFATRecovery::isFileNameCorrupted(const std::wstring& filename) const {
-    if (filename.empty()) return true;
-
-    const std::wstring invalidChars = L"<>:\"/\\|?*";
-    if (filename.find_first_of(invalidChars) != std::wstring::npos) return true;
-
-    int controlCharCount = 0;
-    int unusualCharCount = 0;
-
-    for (wchar_t c : filename) {
-        if (c < 32) controlCharCount++;
-        if (c > 127) unusualCharCount++;
-    }
-
-    // flag as corrupted if half of the filename contains suspicious characters
-    return (controlCharCount > 0 || unusualCharCount > static_cast<int>(filename.length() / 2));
-}
-// Calculate the percentage of deleted file being overwritten by another deleted file
-OverwriteAnalysis exFATRecovery::analyzeClusterOverwrites(uint32_t startCluster, uint64_t expectedSize) {
-    OverwriteAnalysis analysis;
-    analysis.hasOverwrite = false;
-    analysis.overwritePercentage = 0.0;
-    
-
-    uint32_t bytesPerCluster = driveInfo.sectorsPerCluster * driveInfo.bytesPerSector;
-    uint64_t expectedClusters = (expectedSize + bytesPerCluster - 1) / bytesPerCluster;
+// Resolve the chains of files before any of them is analyzed. Called once for all candidates,
+// or for each batch while streaming, so a batch is compared with every file found so far
+void exFATRecovery::buildOwnershipIndex(const std::vector<exFATFileInfo>& files) {
+    std::cout << "[*] Indexing clusters of " << files.size() << " file(s)..." << std::endl;
 
-    uint32_t currentCluster = startCluster;
-    uint64_t currentOffset = 0;
-
-    while (currentOffset < expectedSize && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
-        auto overlaps = clusterHistory.findOverlappingUsage(currentCluster);
-
-        if (!overlaps.empty()) {
-            analysis.hasOverwrite = true;
-            analysis.overwrittenClusters.push_back(currentCluster);
-
-            for (const auto& overlap : overlaps) {
-                analysis.overwrittenBy[currentCluster].push_back(overlap.second.fileId);
-            }
-        }
-
-        clusterHistory.recordClusterUsage(currentCluster, nextFileId, currentOffset);
-
-        currentOffset += bytesPerCluster;
-        currentCluster = getNextCluster(currentCluster);
-    }
+    uint64_t bytesPerCluster = static_cast<uint64_t>(driveInfo.sectorsPerCluster) * driveInfo.bytesPerSector;
+    std::vector<uint32_t> clusterChain;
 
-    if (!analysis.overwrittenClusters.empty()) {
-        analysis.overwritePercentage =
-            static_cast<double>(analysis.overwrittenClusters.size()) / expectedClusters * 100.0;
+    for (const auto& file : files) {
+        if (file.fileSize == 0) continue;
+        clusterChain.clear();
+        resolveClusterChain(file.cluster, file.noFatChain, (file.fileSize + bytesPerCluster - 1) / bytesPerCluster, clusterChain);
+        ownershipIndex.addOwner(file.fileId, CorruptionAnalyzer::buildExtents(clusterChain));
     }
-
-    nextFileId++;
-    return analysis;
+    ownershipIndex.build();
 }
 
 
@@ -499,10 +724,61 @@ std::vector<exFATFileInfo> exFATRecovery::selectFilesToRecover(const std::vector
 }
 
 void exFATRecovery::runLogicalDriveRecovery() {
+    // Asked before the streaming recovery thread is started, so declining leaves nothing running
+    if (!utils.openLogFile() && !utils.confirmProceedWithoutLogFile()) {
+        std::cout << "Exitting..." << std::endl;
+        exit(1);
+    }
+    if (config.stream && (config.recover || config.analyze)) {
+        runStreamingRecovery();
+        return;
+    }
     scanForDeletedFiles();
     recoverPartition();
 }
 
+// Recover files while the scan is still running. addToRecoveryList feeds a bounded queue and a
+// recovery thread takes the files off it in batches, so every file found is selected
+void exFATRecovery::runStreamingRecovery() {
+    streamQueue = std::make_unique<BoundedQueue<exFATFileInfo>>(RecoveryScheduler::STREAM_QUEUE_CAPACITY);
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results;
+    if (config.analyze) {
+        std::cout << "[!] Streaming: overlaps are only checked against files found so far" << std::endl;
+    }
+
+    auto recovering = std::async(std::launch::async, [this, &results]() {
+        std::vector<exFATFileInfo> batch;
+        try {
+            while (streamQueue->popBatch(batch, RecoveryScheduler::STREAM_BATCH_FILES)) {
+                if (config.analyze) buildOwnershipIndex(batch);
+                std::vector<RecoveryStatus> batchResults = recoverFiles(batch);
+                results.insert(results.end(), batchResults.begin(), batchResults.end());
+            }
+        }
+        catch (...) {
+            // Don't leave the scanner blocked on a full queue
+            streamQueue->close();
+            throw;
+        }
+    });
+
+    try {
+        scanForDeletedFiles();
+    }
+    catch (...) {
+        streamQueue->close();
+        recovering.wait();
+        throw;
+    }
+    streamQueue->close();
+    recovering.get();
+    streamQueue.reset();
+    archive.reset();
+
+    if (config.recover) RecoveryScheduler::showSummary(results);
+}
+
 void exFATRecovery::recoverPartition() {
     utils.printHeader("File Recovery and Analysis:");
     if (recoveryList.empty()) {
@@ -528,68 +804,80 @@ void exFATRecovery::recoverPartition() {
         selectedDeletedFiles = recoveryList;
     }
 
-    for (const auto& file : selectedDeletedFiles) {
-        processFileForRecovery(file);
+    if (config.analyze) {
+        buildOwnershipIndex(recoveryList);
     }
+
+    archive = utils.openArchive();
+    std::vector<RecoveryStatus> results = recoverFiles(selectedDeletedFiles);
+    archive.reset();
+    if (config.recover) RecoveryScheduler::showSummary(results);
 }
 
-// Processes each file for recovery based on config options
-void exFATRecovery::processFileForRecovery(const exFATFileInfo& fileInfo) {
-    bool isExtensionPredicted = false;
+// Chains are resolved and analyzed in parallel, the data is read afterwards in disk order
+std::vector<RecoveryStatus> exFATRecovery::recoverFiles(const std::vector<exFATFileInfo>& files) {
+    // Output names are claimed up front, one file after another, so two jobs never pick the same name
+    std::vector<const exFATFileInfo*> jobs;
+    std::vector<fs::path> outputPaths;
+    for (const auto& file : files) {
+        // Skip files that don't match the target cluster and size (if specified)
+        if (file.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (file.cluster != config.targetCluster || file.fileSize != config.targetFileSize))) {
+            continue;
+        }
+        jobs.push_back(&file);
+        outputPaths.push_back(utils.claimOutputPath(file.fileName, config.outputFolder));
+    }
 
-    // Skip files that don't match the target cluster and size (if specified)
-    if (fileInfo.fileSize <= 0 || (config.targetCluster && config.targetFileSize && (fileInfo.cluster != config.targetCluster || fileInfo.fileSize != config.targetFileSize))) {
-        return;
+    std::vector<std::vector<ClusterExtent>> fileExtents(jobs.size());
+    std::vector<RecoveryStatus> results = scheduler.run(jobs.size(), [&](size_t index, uint32_t worker, std::wostream& out) {
+        return processFileForRecovery(*jobs[index], outputPaths[index], workerClusters[worker], fileExtents[index], out);
+    });
+    if (config.recover) {
+        recoverInDiskOrder(jobs, outputPaths, fileExtents, results);
     }
+    return results;
+}
 
+// Processes each file for recovery based on config options
+RecoveryStatus exFATRecovery::processFileForRecovery(const exFATFileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::vector<ClusterExtent>& extents, std::wostream& out) {
+    bool isExtensionPredicted = false;
 
-    fs::path outputPath = utils.getOutputPath(fileInfo.fileName, config.outputFolder);
     uint64_t expectedSize = fileInfo.fileSize;
 
-    exFATRecoveryStatus status = {};
+    RecoveryStatus status = {};
     
 
     uint64_t bytesPerCluster = static_cast<uint64_t>(driveInfo.sectorsPerCluster) * static_cast<uint64_t>(driveInfo.bytesPerSector);
     status.expectedClusters = (expectedSize + bytesPerCluster - 1) / bytesPerCluster;
 
-    std::wcout << "[*] Current file: " << outputPath.filename() << " cluster " << fileInfo.cluster << " (" << expectedSize << " bytes)" << std::endl;
+    out << "[*] Current file: " << outputPath.filename() << " cluster " << fileInfo.cluster << " (" << expectedSize << " bytes)" << std::endl;
     std::vector<uint32_t> clusterChain;
 
 
-    validateClusterChain(status, fileInfo.cluster, clusterChain, expectedSize, outputPath, isExtensionPredicted);
+    validateClusterChain(status, fileInfo.fileId, fileInfo.cluster, fileInfo.noFatChain, clusterChain, outputPath, isExtensionPredicted, usedClusters, out);
 
 
     if (config.recover) {
-        recoverFile(clusterChain, status, outputPath, expectedSize);
+        extents = CorruptionAnalyzer::buildExtents(clusterChain);
     }
-    utils.printItemDivider();
+    utils.printItemDivider(out);
+    return status;
 }
-// Validates cluster chain and finds potential signs of corruption
-void exFATRecovery::validateClusterChain(exFATRecoveryStatus& status, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, uint64_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted){
-    if (config.analyze) std::cout << "[*] Analyzing file clusters..." << std::endl;
-
+// Follows the FAT, or the contiguous extent for NoFatChain files
+void exFATRecovery::resolveClusterChain(uint32_t startCluster, bool noFatChain, uint64_t expectedClusters, std::vector<uint32_t>& clusterChain) {
     uint32_t currentCluster = startCluster;
-    std::set<uint32_t> usedClusters;
-
-    while (clusterChain.size() < status.expectedClusters && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
-        clusterChain.push_back(currentCluster);
-
-        if (config.analyze) {
-            // Check for cluster reuse
-            if (usedClusters.find(currentCluster) != usedClusters.end()) {
-                status.isCorrupted = true;
-                status.hasOverwrittenClusters = true;
-                status.problematicClusters.push_back(currentCluster);
-            }
-            usedClusters.insert(currentCluster);
 
-            // Check if cluster is marked as in use by another file
-            if (isClusterInUse(currentCluster)) {
-                status.isCorrupted = true;
-                status.hasOverwrittenClusters = true;
-                status.problematicClusters.push_back(currentCluster);
-            }
+    if (noFatChain) {
+        // Contiguous file, the FAT entries were never written so there is nothing to walk
+        clusterChain.reserve(expectedClusters);
+        while (clusterChain.size() < expectedClusters && isValidCluster(currentCluster)) {
+            clusterChain.push_back(currentCluster++);
         }
+        return;
+    }
+
+    while (clusterChain.size() < expectedClusters && currentCluster >= 2 && currentCluster < 0x0FFFFFF8) {
+        clusterChain.push_back(currentCluster);
 
         uint32_t nextCluster = getNextCluster(currentCluster);
 
@@ -598,128 +886,107 @@ void exFATRecovery::validateClusterChain(exFATRecoveryStatus& status, const uint
         }
         currentCluster = nextCluster;
     }
+}
+// Validates cluster chain and finds potential signs of corruption
+void exFATRecovery::validateClusterChain(RecoveryStatus& status, uint32_t fileId, const uint32_t startCluster, bool noFatChain, std::vector<uint32_t>& clusterChain, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out){
+    if (config.analyze) out << "[*] Analyzing file clusters..." << std::endl;
 
-    if (config.analyze) {
-        auto overwriteAnalysis = analyzeClusterOverwrites(startCluster, expectedSize);
-        status.hasOverwrittenClusters = overwriteAnalysis.hasOverwrite;
-        if (status.hasOverwrittenClusters) status.isCorrupted = true;
+    resolveClusterChain(startCluster, noFatChain, status.expectedClusters, clusterChain);
+    if (!config.analyze) return;
 
-        status.hasInvalidFileName = isFileNameCorrupted(outputPath.filename().wstring());
-        if (status.hasInvalidFileName) {
-            status.isCorrupted;
-        }
+    std::vector<ClusterExtent> extents = CorruptionAnalyzer::buildExtents(clusterChain);
 
-        if (!isValidCluster(startCluster)) {
-            status.isCorrupted = true;
-            std::cout << "  [-] Invalid starting cluster: 0x" << std::hex << startCluster << std::dec << std::endl;
+    if (!noFatChain) {
+        // Check for cluster reuse, a whole run at a time
+        usedClusters.clear();
+        for (const ClusterExtent& extent : extents) {
+            uint64_t duplicate = 0;
+            if (usedClusters.insertRange(extent.start, extent.length, &duplicate) > 0) {
+                status.isCorrupted = true;
+                status.hasOverwrittenClusters = true;
+                status.problematicClusters.push_back(duplicate);
+            }
         }
 
-        // Check if extension was either missing or had invalid characters
-        if (isExtensionPredicted) {
-            status.isCorrupted = true;
-            status.hasInvalidExtension = true;
+        for (uint32_t currentCluster : clusterChain) {
+            // Check if cluster is marked as in use by another file
+            if (isClusterInUse(currentCluster)) {
+                status.isCorrupted = true;
+                status.hasOverwrittenClusters = true;
+                status.problematicClusters.push_back(currentCluster);
+            }
         }
+    }
 
-        analyzeClusterPattern(clusterChain, status);
-        showAnalysisResult(status);
+    // Clusters claimed by other deleted files, whichever of them was analyzed first
+    auto overwriteAnalysis = ownershipIndex.analyzeOverwrites(fileId, status.expectedClusters);
+    CorruptionAnalyzer::applyOverwriteAnalysis(overwriteAnalysis, status, out);
+
+    status.hasInvalidFileName = CorruptionAnalyzer::isFileNameCorrupted(outputPath.filename().wstring());
+    if (status.hasInvalidFileName) {
+        status.isCorrupted = true;
     }
 
-}
+    if (!isValidCluster(startCluster)) {
+        status.isCorrupted = true;
+        out << "  [-] Invalid starting cluster: 0x" << std::hex << startCluster << std::dec << std::endl;
+    }
 
-void exFATRecovery::recoverFile(const std::vector<uint32_t>& clusterChain, exFATRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize) {
-    std::cout << "[*] Recovering file..." << std::endl;
-    std::ofstream outputFile(outputPath, std::ios::binary);
-    if (!outputFile) {
-        throw std::runtime_error("[-] Failed to create output file.");
+    // Check if extension was either missing or had invalid characters
+    if (isExtensionPredicted) {
+        status.isCorrupted = true;
+        status.hasInvalidExtension = true;
     }
-    // Recovery
-    std::vector<uint8_t> sectorBuffer(driveInfo.bytesPerSector);
-    for (uint32_t cluster : clusterChain) {
-        uint32_t sector = clusterToSector(cluster);
 
-        for (uint64_t i = 0; i < driveInfo.sectorsPerCluster; ++i) {
-            
-            if (!readSector(static_cast<uint64_t>(sector) + i, sectorBuffer.data(), driveInfo.bytesPerSector)) {
-                continue;
-            }
+    CorruptionAnalyzer::analyzeClusterPattern<uint32_t>(extents, status);
+    CorruptionAnalyzer::showAnalysisResult(status, out);
 
-            uint64_t bytesToWrite = (std::min)(
-                static_cast<uint64_t>(driveInfo.bytesPerSector),
-                expectedSize - status.recoveredBytes
-                );
+}
 
-            outputFile.write(reinterpret_cast<char*>(sectorBuffer.data()), bytesToWrite);
-            status.recoveredBytes += bytesToWrite;
-            utils.showProgress(status.recoveredBytes, expectedSize);
+// Reads the chains of all selected files in one pass over the volume
+void exFATRecovery::recoverInDiskOrder(const std::vector<const exFATFileInfo*>& files, const std::vector<fs::path>& outputPaths, const std::vector<std::vector<ClusterExtent>>& fileExtents, std::vector<RecoveryStatus>& results) {
+    utils.printHeader("Recovering Files:");
+    uint32_t bytesPerSector = driveInfo.bytesPerSector;
+    uint64_t bytesPerCluster = static_cast<uint64_t>(driveInfo.sectorsPerCluster) * bytesPerSector;
+    auto clusterToOffset = [this, bytesPerSector](uint64_t cluster) {
+        return clusterToSector(static_cast<uint32_t>(cluster)) * bytesPerSector;
+    };
 
-            if (status.recoveredBytes >= expectedSize) break;
-        }
-        status.recoveredClusters++;
-        if (status.recoveredBytes >= expectedSize) break;
+    ReadPlanner planner;
+    OutputFileCache plainFiles;
+    OutputSink& outputs = archive ? static_cast<OutputSink&>(*archive) : plainFiles;
+    planner.reset(files.size());
+    for (uint32_t i = 0; i < files.size(); i++) {
+        // Only ValidDataLength bytes were ever written, everything past it stays zero
+        uint64_t dataLength = (std::min)(files[i]->validDataLength, files[i]->fileSize);
+        outputs.addFile(i, outputPaths[i], files[i]->fileSize);
+        planner.addFile(i, fileExtents[i], dataLength, bytesPerCluster, clusterToOffset);
     }
-    outputFile.close();
 
-    showRecoveryResult(status, outputPath, expectedSize);
+    planner.execute(*sectorReader, scheduler, bytesPerSector, static_cast<uint64_t>(config.readGapKiB) * 1024, outputs,
+        [this](uint64_t done, uint64_t total) { utils.showProgress(done, total); });
+    outputs.finish();
+
+    for (uint32_t i = 0; i < files.size(); i++) {
+        const ReadPlanner::FileTotals& totals = planner.getTotals(i);
+        uint64_t dataLength = (std::min)(files[i]->validDataLength, files[i]->fileSize);
+        results[i].recoveredBytes = totals.readBytes + (files[i]->fileSize - dataLength);
+        results[i].recoveredClusters = (totals.readBytes + bytesPerCluster - 1) / bytesPerCluster;
+        showRecoveryResult(results[i], outputPaths[i], files[i]->fileSize, std::wcout);
+    }
+    utils.printItemDivider();
 }
 
 /* Recovery and analysis results */
-void exFATRecovery::showRecoveryResult(const exFATRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize) const {
-    std::cout << "\n  [*] Clusters recovered: " << status.recoveredClusters
+void exFATRecovery::showRecoveryResult(const RecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize, std::wostream& out) const {
+    out << "  [*] Clusters recovered: " << status.recoveredClusters
         << " / " << status.expectedClusters << std::endl;
-    std::cout << "  [*] Bytes recovered: " << status.recoveredBytes
+    out << "  [*] Bytes recovered: " << status.recoveredBytes
         << " / " << expectedSize << std::endl;
-    if (fs::exists(fs::absolute(outputPath))) {
-        std::wcout << "  [+] File saved to " << fs::absolute(outputPath) << L"\n";
-    }
-    else std::wcout << "  [-] Failed to save file" << std::endl;
+    utils.showSavedFile(outputPath, out);
 
 
 }
-void exFATRecovery::showAnalysisResult(const exFATRecoveryStatus& status) const {
-    if (status.isCorrupted) {
-        // std::cout << "\n[*] Recovery Status:" << std::endl;
-        std::cout << "  [-] Warning: File appears to be corrupted" << std::endl;
-
-        if (status.hasInvalidFileName) {
-            std::cout << "  [-] Filename is corrupted or invalid" << std::endl;
-        }
-        if (status.hasInvalidExtension) {
-            std::cout << "  [-] File extension was either missing or contained invalid characters" << std::endl;
-        }
-
-        // Overwritten by other files
-        if (status.hasOverwrittenClusters) {
-            std::cout << "  [-] Some clusters may have been overwritten" << std::endl;
-            std::cout << "  [-] Problematic clusters: ";
-
-            for (auto cluster : status.problematicClusters) {
-                std::cout << "0x" << std::hex << cluster << " ";
-            }
-            std::cout << std::dec << std::endl;
-        }
-
-
-        if (status.hasFragmentedClusters) {
-            std::cout << "  [-] Some clusters are fragmented" << std::endl;
-            std::cout << "      - Fragmentation score: "
-                << std::fixed << std::setprecision(2)
-                << (status.fragmentation) << "%" << std::endl;
-        }
-        if (status.hasRepeatedClusters) {
-            std::cout << "  [-] Repeated clusters found: "
-                << status.repeatedClusters << std::endl;
-        }
-        if (status.hasBackJumps) {
-            std::cout << "  [-] Backward jumps detected: "
-                << status.backJumps << std::endl;
-        }
-        if (status.hasLargeGaps) {
-            std::cout << "  [-] Large gaps detected: "
-                << status.largeGaps << std::endl;
-        }
-    }
-    else std::cout << "  [+] No signs of corruption found " << std::endl;
-}
 
 
 /* Public */
@@ -6,10 +6,18 @@
 #include "exFATStructs.h"
 #include "LogicalDriveReader.h"
 #include "Enums.h"
-#include "ClusterHistory.h"
+#include "ClusterOwnershipIndex.h"
+#include "ClusterBitset.h"
+#include "CorruptionAnalyzer.h"
+#include "RecoveryScheduler.h"
+#include "ReadPlanner.h"
+#include "OutputFileCache.h"
+#include "BoundedQueue.h"
+#include "ArchiveSink.h"
 #include <cstdint>
 #include <memory>
 #include <vector>
+#include <unordered_set>
 #include <fstream>
 #include <filesystem>
 //#include <iostream>
@@ -19,22 +27,36 @@ namespace fs = std::filesystem;
 class exFATRecovery : public IConfigurable{
 private:
     // File corruption analysis
-    static constexpr uint32_t MINIMUM_CLUSTERS_FOR_ANALYSIS = 10; // 5
-    static constexpr uint32_t LARGE_GAP_THRESHOLD = 1000; // 1000
-    static constexpr double SUSPICIOUS_PATTERN_THRESHOLD = 0.1; // 10%
-    static constexpr double SEVERE_PATTERN_THRESHOLD = 0.25;    // 25%
-    static constexpr double FILENAME_CORRUTPION_THRESHOLD = 0.5; // 50% bad chars in name
-    ClusterHistory clusterHistory;
-    uint32_t nextFileId = 0;
+    ClusterOwnershipIndex ownershipIndex;  // Built over all candidate files before analysis
+    std::vector<ClusterBitset> workerClusters; // Duplicate clusters within one chain, one per recovery worker and cleared per file
+    RecoveryScheduler scheduler;           // Recovers the selected files in parallel
+    std::unique_ptr<BoundedQueue<exFATFileInfo>> streamQueue; // Files found so far, only while streaming
+    std::unique_ptr<ArchiveSink> archive; // All recovered files, only when writing to an archive
 
     // Cluster values
     static constexpr uint32_t MIN_DATA_CLUSTER = 2;         // First valid data cluster for exFAT
     static constexpr uint32_t BAD_CLUSTER = 0xFFFFFFF7;     // exFAT bad cluster marker
     static constexpr uint32_t END_OF_CHAIN = 0xFFFFFFFF;    // exFAT end of chain marker
 
+    // Stream extension flags
+    static constexpr uint8_t NO_FAT_CHAIN_FLAG = 0x02;      // Clusters are contiguous, FAT is not used
+
+    // Largest single read issued while recovering file data
+    static constexpr uint32_t MAX_READ_BLOCK_SIZE = 4 * 1024 * 1024;
+
     // Prevent infinite loops in file scan
     static constexpr uint32_t MAX_RECURSION_DEPTH = 100;
-    uint32_t currentRecursionDepth = 0;
+    static constexpr uint64_t MAX_DIRECTORY_SIZE = 256 * 1024 * 1024; // exFAT directory size limit
+    std::unordered_set<uint32_t> scannedDirectories;  // every directory cluster already parsed
+
+    // Entry set validation
+    static constexpr uint8_t UPCASE_TABLE_ENTRY = 0x82;
+    static constexpr uint32_t NAME_CHARS_PER_ENTRY = 15;
+    std::vector<uint16_t> upcaseTable;  // Expanded volume up-case table, one slot per UTF-16 code unit
+    uint64_t rejectedEntrySets = 0;
+
+    // Orphaned directory carving
+    static constexpr uint32_t CARVE_READ_BLOCK_SIZE = 4 * 1024 * 1024; // Per-thread read size
 
     struct DriveInfo {
         ExFATBootSector bootSector;
@@ -46,7 +68,7 @@ private:
 
     const DriveType& driveType;
     std::vector<exFATFileInfo> recoveryList;
-    uint16_t fileId = 1;
+    uint32_t fileId = 1;
 
     std::unique_ptr<SectorReader> sectorReader;
 
@@ -54,50 +76,65 @@ private:
     void printToolHeader() const;
 
     /* Helper functions for entry type checking */
-    inline bool IsDirectoryEntry(uint8_t entryType);
-    inline bool IsStreamExtensionEntry(uint8_t entryType);
-    inline bool IsFileNameEntry(uint8_t entryType);
-    inline bool IsEntryInUse(uint8_t entryType);
+    inline bool IsDirectoryEntry(uint8_t entryType) const;
+    inline bool IsStreamExtensionEntry(uint8_t entryType) const;
+    inline bool IsFileNameEntry(uint8_t entryType) const;
+    inline bool IsSecondaryEntry(uint8_t entryType) const;
+    inline bool IsEntryInUse(uint8_t entryType) const;
 
     void setSectorReader(std::unique_ptr<SectorReader> reader);
     bool readSector(uint64_t sector, void* buffer, uint32_t size);
+    bool readSectors(uint64_t sector, uint32_t sectorCount, void* buffer, uint32_t sectorSize);
     void readBootSector(uint32_t sector);
     uint32_t getBytesPerSector();
     
     bool isValidCluster(uint32_t cluster) const;
     bool isValidDeletedEntry(uint32_t cluster, uint64_t size) const;
 
-    uint32_t clusterToSector(uint32_t cluster);
+    uint64_t clusterToSector(uint32_t cluster);
     uint32_t getNextCluster(uint32_t cluster);
 
 
     /* File scan */
     void scanForDeletedFiles();
-    void scanDirectory(uint32_t cluster, uint32_t depth = 0);
-    void processEntriesInSector(uint32_t entriesPerSector, const std::vector<uint8_t>& sectorBuffer);
+    void scanDirectory(uint32_t cluster, uint64_t dataLength = 0, bool noFatChain = false, bool isDeleted = false, uint32_t depth = 0);
+    // streamClusters, if given, receives the clusters the stream was read from
+    bool readDirectoryStream(uint32_t cluster, uint64_t dataLength, bool noFatChain, std::vector<uint8_t>& dirStream, std::vector<uint32_t>* streamClusters = nullptr);
+    void processDirectoryStream(const std::vector<uint8_t>& dirStream, bool isDeletedDirectory, uint32_t depth);
+    size_t processEntrySet(const DirectoryEntryCommon* entries, size_t index, size_t entryCount, bool forceDeleted, uint32_t depth);
+    // Deep scan: look for entry sets past the end-of-directory marker
+    void scanDirectorySlack(const std::vector<uint8_t>& dirStream, size_t firstEntry, uint32_t depth);
+    // Carving: sweep the cluster heap for directory clusters that can't be reached from the root
+    void carveOrphanedDirectories();
+    bool isDirectoryCluster(const uint8_t* clusterData, uint32_t bytesPerCluster) const;
     void processDirectoryEntry(const DirectoryEntryCommon* entry, exFATDirEntryData& dirData);
-    void finalizeDirectoryEntry(exFATDirEntryData& dirData);
+    void finalizeDirectoryEntry(exFATDirEntryData& dirData, uint32_t depth);
+    void loadUpcaseTable();
+    bool isValidEntrySet(const DirectoryEntryCommon* entrySet, size_t entryCount) const;
+    uint16_t computeSetChecksum(const DirectoryEntryCommon* entrySet, size_t entryCount) const;
+    uint16_t computeNameHash(const uint16_t* name, uint32_t nameLength) const;
     exFATFileInfo parseFileInfo(const exFATDirEntryData& dirData);
     std::wstring extractFileName(const FileNameEntry* fnEntry) const;
     void addToRecoveryList(const exFATFileInfo& fileInfo);
     void recoverPartition();
+    std::vector<RecoveryStatus> recoverFiles(const std::vector<exFATFileInfo>& files);
 
     /* Corruption analysis */
     bool isClusterInUse(uint32_t cluster);
-    void analyzeClusterPattern(const std::vector<uint32_t>& clusters, exFATRecoveryStatus& status) const;
-    bool isFileNameCorrupted(const std::wstring& filename) const;
-    OverwriteAnalysis analyzeClusterOverwrites(uint32_t startCluster, uint64_t expectedSize);
+    void buildOwnershipIndex(const std::vector<exFATFileInfo>& files);
 
     /* Recovery */
     std::vector<exFATFileInfo> selectFilesToRecover(const std::vector<exFATFileInfo>& recoveryList);
     void runLogicalDriveRecovery();
-    void processFileForRecovery(const exFATFileInfo& fileInfo);
-    void validateClusterChain(exFATRecoveryStatus& status, const uint32_t startCluster, std::vector<uint32_t>& clusterChain, uint64_t expectedSize, const fs::path& outputPath, bool isExtensionPredicted);
-    void recoverFile(const std::vector<uint32_t>& clusterChain, exFATRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize);
+    void runStreamingRecovery();
+    RecoveryStatus processFileForRecovery(const exFATFileInfo& fileInfo, const fs::path& outputPath, ClusterBitset& usedClusters, std::vector<ClusterExtent>& extents, std::wostream& out);
+    void resolveClusterChain(uint32_t startCluster, bool noFatChain, uint64_t expectedClusters, std::vector<uint32_t>& clusterChain);
+    void validateClusterChain(RecoveryStatus& status, uint32_t fileId, const uint32_t startCluster, bool noFatChain, std::vector<uint32_t>& clusterChain, const fs::path& outputPath, bool isExtensionPredicted, ClusterBitset& usedClusters, std::wostream& out);
+    // Read the data of all selected files in one sweep sorted by position on the volume
+    void recoverInDiskOrder(const std::vector<const exFATFileInfo*>& files, const std::vector<fs::path>& outputPaths, const std::vector<std::vector<ClusterExtent>>& fileExtents, std::vector<RecoveryStatus>& results);
 
     /* Recovery and analysis results */
-    void showRecoveryResult(const exFATRecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize) const;
-    void showAnalysisResult(const exFATRecoveryStatus& status) const;
+    void showRecoveryResult(const RecoveryStatus& status, const fs::path& outputPath, const uint64_t expectedSize, std::wostream& out) const;
 public:
     exFATRecovery(const DriveType& driveType, std::unique_ptr<SectorReader> reader);
     ~exFATRecovery();
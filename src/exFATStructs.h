@@ -5,10 +5,12 @@
 
 #pragma pack(push, 1)
 struct exFATFileInfo {
-    uint16_t fileId;
+    uint32_t fileId;
     std::wstring fileName;
     uint64_t fileSize;
+    uint64_t validDataLength; // Bytes of fileSize actually written, rest reads as zeros
     uint32_t cluster;
+    bool noFatChain;          // Data is one contiguous extent, FAT entries are not maintained
 };
 
 struct ExFATBootSector {
@@ -81,32 +83,26 @@ struct FileNameEntry {
     uint16_t FileName[15];  // Part of the Unicode filename (up to 15 chars)
 };
 
+// Type 0x82: Up-case Table Entry
+struct UpcaseTableEntry {
+    uint8_t EntryType;      // Must be 0x82
+    uint8_t Reserved1[3];
+    uint32_t TableChecksum; // Checksum of the up-case table data
+    uint8_t Reserved2[12];
+    uint32_t FirstCluster;  // First cluster of the up-case table
+    uint64_t DataLength;    // Size of the up-case table in bytes
+};
+
 struct exFATDirEntryData {
     std::wstring longFilename;
     uint32_t startingCluster;
     uint64_t fileSize;
+    uint64_t validDataLength;
+    uint8_t nameLength;
+    bool noFatChain;
     bool inFileEntry;
     bool isDirectory;
     bool isDeleted;
 };
 
-struct exFATRecoveryStatus {
-    bool isCorrupted;
-    bool hasFragmentedClusters;
-    double fragmentation;
-    bool hasBackJumps;
-    uint32_t backJumps;
-    bool hasRepeatedClusters;
-    uint32_t repeatedClusters;
-    bool hasLargeGaps;
-    uint32_t largeGaps;
-    bool hasOverwrittenClusters;
-    bool hasInvalidFileName;
-    bool hasInvalidExtension;
-    uint64_t expectedClusters;
-    uint64_t recoveredClusters;
-    uint64_t recoveredBytes;
-    std::vector<uint64_t> problematicClusters;
-};
-
 #pragma pack(pop)
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <windows.h>
 #include <string>
 #include <sstream>
+#include <filesystem>
 // Helper function to convert string to wstring
 std::wstring stringToWstring(const std::string& str) {
     if (str.empty()) {
@@ -25,7 +26,14 @@ void printUsage(const char* programName) {
         << "  -d, --drive <drive>                 [REQUIRED] Specify the drive path\n"
         << "  -r, --recover                       [OPTIONAL] Perform file recovery\n"
         << "  -a, --analyze                       [OPTIONAL] Analyze clusters for corruption (time-consuming)\n"
-        << "  -l, --no-log                        [OPTIONAL] Disable logging found files and their location\n";
+        << "  -l, --no-log                        [OPTIONAL] Disable logging found files and their location\n"
+        << "  -s, --deep-scan                     [OPTIONAL] Also scan directory and MFT record slack for older entries\n"
+        << "  -c, --carve                         [OPTIONAL] Sweep all clusters for orphaned directories or FILE records (time-consuming)\n"
+        << "  -u, --usn-journal <days>            [OPTIONAL] NTFS: find files deleted in the last <days> days from the change journal\n"
+        << "  -g, --read-gap <KiB>                [OPTIONAL] Merge recovery reads at most <KiB> apart on disk (default 128)\n"
+        << "  -t, --stream                        [OPTIONAL] Recover every file found while the scan is still running, without a selection prompt\n"
+        << "  -k, --sink <plain|tar|zip>          [OPTIONAL] Write recovered files as plain files (default) or into one archive\n"
+        << "  -p, --sink-path <path>              [OPTIONAL] Archive file or named pipe (\\\\.\\pipe\\<name>), default Recovered.tar/.zip in the output folder\n";
 
     std::cerr << "\nExamples:\n"
         << "  1. Logical Drive:\n"
@@ -38,6 +46,22 @@ void printUsage(const char* programName) {
         << "      * The `FileDataLog.txt` is in CSV format, facilitating easy automation.\n"
         << "  - File corruption analysis:\n"
         << "      * Use '--analyze' argument to scan recovered file for potential corruption.\n"
+        << "  - Deep scan:\n"
+        << "      * Use '--deep-scan' to look for deleted entries left behind the end of each directory.\n"
+        << "  - Orphaned directories:\n"
+        << "      * Use '--carve' to find deleted folders whose parent entry was overwritten.\n"
+        << "      * On NTFS, '--carve' finds FILE records left outside the current MFT (e.g. after a reformat).\n"
+        << "  - Change journal:\n"
+        << "      * Use '--usn-journal 7' to list files deleted during the last week without a full MFT scan.\n"
+        << "  - Read order:\n"
+        << "      * Selected files are read in one pass sorted by disk position. Use '--read-gap 0' on SSDs, larger values on HDDs.\n"
+        << "  - Streaming:\n"
+        << "      * '--stream' recovers every file found, in batches, while the scan goes on. '--analyze' only reports overlaps\n"
+        << "        with files found so far and NTFS files are written flat into the output folder.\n"
+        << "        Nothing can be deselected: NTFS '$Slack' streams, '$LogFile' rebuilds and carved records are recovered too.\n"
+        << "  - Archive output:\n"
+        << "      * '--sink tar' or '--sink zip' (stored, no compression) writes everything as one sequential stream, which avoids\n"
+        << "        creating thousands of small files on the destination. Files are then read one after another instead of in disk order.\n"
         << "  - Supported file systems:\n"
         << "      * Currently, only FAT32 and exFAT file recovery is supported.\n";
 
@@ -56,7 +80,14 @@ void printConfig(const Config& config) {
         << L"  Target File Size       | " << (config.targetFileSize ? std::to_wstring(config.targetFileSize) : L"Not specified") << L"\n"
         << L"  Create File Data Log   | " << (config.createFileDataLog ? L"Yes" : L"No") << L"\n"
         << L"  Recover Files          | " << (config.recover ? L"Yes" : L"No") << L"\n"
-        << L"  Analyze Files          | " << (config.analyze ? "Yes" : "No") << L"\n";
+        << L"  Analyze Files          | " << (config.analyze ? "Yes" : "No") << L"\n"
+        << L"  Deep Scan              | " << (config.deepScan ? L"Yes" : L"No") << L"\n"
+        << L"  Carve Directories      | " << (config.carve ? L"Yes" : L"No") << L"\n"
+        << L"  USN Journal Days       | " << (config.usnJournalDays ? std::to_wstring(config.usnJournalDays) : L"Not used") << L"\n"
+        << L"  Read Gap Tolerance     | " << config.readGapKiB << L" KiB\n"
+        << L"  Stream Recovery        | " << (config.stream ? L"Yes" : L"No") << L"\n"
+        << L"  Output Sink            | " << (config.outputSink == OutputSinkType::TAR_TYPE ? L"tar, " + config.sinkPath
+            : config.outputSink == OutputSinkType::ZIP_TYPE ? L"zip, " + config.sinkPath : std::wstring(L"Plain files")) << L"\n";
     std::cout << std::string(60, '_') << "\n\n";
 }
 // Function to parse command line arguments
@@ -82,6 +113,46 @@ void parseCommandLine(int argc, char* argv[], Config& config) {
             else if (arg == "-a" || arg == "--analyze") {
                 config.analyze = true;
             }
+            else if (arg == "-s" || arg == "--deep-scan") {
+                config.deepScan = true;
+            }
+            else if (arg == "-c" || arg == "--carve") {
+                config.carve = true;
+            }
+            else if (arg == "-t" || arg == "--stream") {
+                config.stream = true;
+            }
+            else if (arg == "-u" || arg == "--usn-journal") {
+                if (i + 1 < argc) {
+                    config.usnJournalDays = static_cast<uint32_t>(std::stoul(argv[++i]));
+                }
+                if (config.usnJournalDays == 0) {
+                    throw std::runtime_error("--usn-journal needs a number of days");
+                }
+            }
+            else if (arg == "-g" || arg == "--read-gap") {
+                if (i + 1 < argc) {
+                    config.readGapKiB = static_cast<uint32_t>(std::stoul(argv[++i]));
+                }
+                else {
+                    throw std::runtime_error("--read-gap needs a size in KiB");
+                }
+            }
+            else if (arg == "-k" || arg == "--sink") {
+                std::string sink = i + 1 < argc ? argv[++i] : "";
+                if (sink == "plain") config.outputSink = OutputSinkType::PLAIN_TYPE;
+                else if (sink == "tar") config.outputSink = OutputSinkType::TAR_TYPE;
+                else if (sink == "zip") config.outputSink = OutputSinkType::ZIP_TYPE;
+                else throw std::runtime_error("--sink needs plain, tar or zip");
+            }
+            else if (arg == "-p" || arg == "--sink-path") {
+                if (i + 1 < argc) {
+                    config.sinkPath = stringToWstring(argv[++i]);
+                }
+                else {
+                    throw std::runtime_error("--sink-path needs a file or pipe name");
+                }
+            }
             else if (arg == "-h" || arg == "--help") {
                 printUsage(argv[0]);
                 exit(0);
@@ -101,6 +172,9 @@ void parseCommandLine(int argc, char* argv[], Config& config) {
     if (config.drivePath.empty()) {
         throw std::runtime_error("--drive argument is missing");
     }
+    if (config.outputSink != OutputSinkType::PLAIN_TYPE && config.sinkPath.empty()) {
+        config.sinkPath = (std::filesystem::path(config.outputFolder) / (config.outputSink == OutputSinkType::TAR_TYPE ? L"Recovered.tar" : L"Recovered.zip")).wstring();
+    }
 
     printConfig(config);
 }